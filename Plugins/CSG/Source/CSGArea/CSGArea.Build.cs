@@ -42,6 +42,9 @@ public class CSGArea : ModuleRules
 				"SlateCore",
 				"GeometryScriptingCore",
 				"GeometryFramework",
+				"GeometryCore",
+				"GeometryAlgorithms",
+				"DynamicMesh",
 				"PhysicsCore"
 
 				// ... add private dependencies that you statically link with here ...	
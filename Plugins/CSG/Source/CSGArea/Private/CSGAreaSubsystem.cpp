@@ -0,0 +1,92 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGAreaSubsystem.h"
+
+#include "PluginSettings.h"
+#include "Components/CSGAreaComponent.h"
+#include "Components/CSGBaseComponent.h"
+
+void UCSGAreaSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const double CellSize = FMath::Max(1.0f, GetDefault<UPluginSettings>()->AreaGridCellSize);
+	Areas = TCSGSpatialGrid<UCSGAreaComponent>(CellSize);
+	Components = TCSGSpatialGrid<UCSGBaseComponent>(CellSize);
+}
+
+FBox UCSGAreaSubsystem::GetAreaBounds(const UCSGAreaComponent* Area)
+{
+	return FBox::BuildAABB(Area->GetComponentLocation(), FVector(Area->GetCutterWorldRadius()));
+}
+
+void UCSGAreaSubsystem::RegisterArea(UCSGAreaComponent* Area)
+{
+	Area->TransformUpdated.AddUObject(this, &UCSGAreaSubsystem::OnAreaTransformUpdated);
+	Area->OnAreaChanged.AddUObject(this, &UCSGAreaSubsystem::OnAreaChanged);
+
+	UpdateArea(Area);
+}
+
+void UCSGAreaSubsystem::UnregisterArea(UCSGAreaComponent* Area)
+{
+	Area->TransformUpdated.RemoveAll(this);
+	Area->OnAreaChanged.RemoveAll(this);
+
+	const FBox Bounds = Areas.GetBounds(Area);
+	Areas.Remove(Area);
+	NotifyComponents(Bounds, Area->CSGLayers);
+}
+
+void UCSGAreaSubsystem::UpdateCSGComponent(UCSGBaseComponent* Component)
+{
+	Components.Update(Component, Component->GetCSGSourceBounds());
+}
+
+void UCSGAreaSubsystem::UnregisterCSGComponent(UCSGBaseComponent* Component)
+{
+	Components.Remove(Component);
+}
+
+void UCSGAreaSubsystem::QueryAreas(const FBox& Bounds, TArray<UCSGAreaComponent*>& OutAreas) const
+{
+	Areas.Query(Bounds, OutAreas);
+}
+
+void UCSGAreaSubsystem::OnAreaTransformUpdated(USceneComponent* UpdatedComponent,
+                                               EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	UpdateArea(CastChecked<UCSGAreaComponent>(UpdatedComponent));
+}
+
+void UCSGAreaSubsystem::OnAreaChanged(UCSGAreaComponent* Area)
+{
+	UpdateArea(Area);
+}
+
+void UCSGAreaSubsystem::UpdateArea(UCSGAreaComponent* Area)
+{
+	//components the area left need a rebuild just as much as the ones it entered
+	const FBox OldBounds = Areas.GetBounds(Area);
+	const FBox NewBounds = GetAreaBounds(Area);
+	Areas.Update(Area, NewBounds);
+
+	NotifyComponents(OldBounds, Area->CSGLayers);
+	NotifyComponents(NewBounds, Area->CSGLayers);
+}
+
+void UCSGAreaSubsystem::NotifyComponents(const FBox& Bounds, int32 Layers) const
+{
+	//components are merged in the rebuild queue, so being notified twice is fine
+	TArray<UCSGBaseComponent*> Found;
+	Components.Query(Bounds, Found);
+	for (UCSGBaseComponent* Component : Found)
+	{
+		//components ignoring the area don't even get queued
+		if (Component->AcceptsLayers(Layers))
+		{
+			Component->RequestRebuild();
+		}
+	}
+}
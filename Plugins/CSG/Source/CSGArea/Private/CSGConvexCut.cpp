@@ -0,0 +1,130 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGMeshOperations.h"
+
+#include "CSGStats.h"
+#include "ConstrainedDelaunay2.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "Operations/MeshPlaneCut.h"
+
+using namespace UE::Geometry;
+
+namespace
+{
+	/// @brief Cutters with more distinct face planes than this are left to the mesh boolean
+	constexpr int32 MaxConvexPlanes = 64;
+
+	struct FCutPlane
+	{
+		FVector3d Origin;
+		FVector3d Normal;
+	};
+
+	/// @brief Collects the distinct face planes of the cutter in the local space of the mesh, facing outward
+	bool GatherPlanes(const FDynamicMesh3& Cutter, const FTransform& ComponentTransform, const FTransform& AreaTransform,
+	                  TArray<FCutPlane>& OutPlanes)
+	{
+		//mirroring transforms flip the winding of the cutter
+		const bool bFlip = AreaTransform.GetDeterminant() * ComponentTransform.GetDeterminant() < 0.0;
+		const double Tolerance = 1e-4 * FMath::Max(1.0, Cutter.GetBounds(true).MaxDim());
+
+		for (const int32 Triangle : Cutter.TriangleIndicesItr())
+		{
+			FVector3d Vertices[3];
+			Cutter.GetTriVertices(Triangle, Vertices[0], Vertices[1], Vertices[2]);
+			for (FVector3d& Vertex : Vertices)
+			{
+				Vertex = ComponentTransform.InverseTransformPosition(AreaTransform.TransformPosition(Vertex));
+			}
+
+			FVector3d Normal = VectorUtil::Normal(Vertices[0], Vertices[1], Vertices[2]);
+			if (Normal.SquaredLength() < 0.5)
+			{
+				continue;
+			}
+			if (bFlip)
+			{
+				Normal = -Normal;
+			}
+
+			const bool bDuplicate = OutPlanes.ContainsByPredicate([&](const FCutPlane& Plane)
+			{
+				return Plane.Normal.Dot(Normal) > 1.0 - 1e-6 &&
+					FMath::Abs(Plane.Normal.Dot(Vertices[0] - Plane.Origin)) < Tolerance;
+			});
+			if (bDuplicate)
+			{
+				continue;
+			}
+
+			if (OutPlanes.Num() == MaxConvexPlanes)
+			{
+				return false;
+			}
+			OutPlanes.Add({Vertices[0], Normal});
+		}
+
+		return !OutPlanes.IsEmpty();
+	}
+}
+
+bool CSG::TryConvexCut(const FDynamicMesh3& Mesh, const FTransform& ComponentTransform, const FCSGAreaSnapshot& Area,
+                       EBooleanOp Operation, int32 MaterialID, FDynamicMesh3& OutMesh)
+{
+	if (Operation != EBooleanOp::Intersection || !Area.Cutter ||
+		(Area.Shape != ECSGAreaShape::Box && Area.Shape != ECSGAreaShape::Convex))
+	{
+		return false;
+	}
+
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGAnalyticCut);
+
+	TArray<FCutPlane> Planes;
+	if (!GatherPlanes(*Area.Cutter, ComponentTransform, Area.Transform, Planes))
+	{
+		return false;
+	}
+
+	OutMesh = Mesh;
+	FDynamicMeshMaterialAttribute* MaterialIDs = OutMesh.HasAttributes() ? OutMesh.Attributes()->GetMaterialID() : nullptr;
+
+	for (const FCutPlane& Plane : Planes)
+	{
+		//the plane cut discards everything in front of the plane, which is outside the cutter
+		FMeshPlaneCut Cut(&OutMesh, Plane.Origin, Plane.Normal);
+		if (!Cut.Cut())
+		{
+			return false;
+		}
+
+		TBitArray<> Existing(false, OutMesh.MaxTriangleID());
+		for (const int32 Triangle : OutMesh.TriangleIndicesItr())
+		{
+			Existing[Triangle] = true;
+		}
+
+		if (!Cut.HoleFill(ConstrainedDelaunayTriangulate<double>, true))
+		{
+			return false;
+		}
+
+		if (MaterialIDs)
+		{
+			for (const int32 Triangle : OutMesh.TriangleIndicesItr())
+			{
+				if (Triangle >= Existing.Num() || !Existing[Triangle])
+				{
+					MaterialIDs->SetValue(Triangle, MaterialID);
+				}
+			}
+		}
+
+		if (OutMesh.TriangleCount() == 0)
+		{
+			break;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,100 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGInstanceSubsystem.h"
+
+#include "Components/CSGStaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+
+void UCSGInstanceSubsystem::AddInstance(UCSGStaticMeshComponent* Component, UStaticMesh* Mesh,
+                                        const TArray<TObjectPtr<UMaterialInterface>>& Materials)
+{
+	if (ComponentBatches.Contains(Component))
+	{
+		return;
+	}
+
+	const int32 BatchIndex = FindOrAddBatch(Mesh, Materials);
+	FCSGInstanceBatch& Batch = Batches[BatchIndex];
+	Batch.Instances->AddInstance(Component->GetComponentTransform(), true);
+	Batch.Components.Add(Component);
+	ComponentBatches.Add(Component, BatchIndex);
+}
+
+void UCSGInstanceSubsystem::RemoveInstance(UCSGStaticMeshComponent* Component)
+{
+	int32 BatchIndex;
+	if (!ComponentBatches.RemoveAndCopyValue(Component, BatchIndex))
+	{
+		return;
+	}
+
+	//removing an instance shifts the ones after it down, the component list follows along
+	FCSGInstanceBatch& Batch = Batches[BatchIndex];
+	const int32 InstanceIndex = Batch.Components.IndexOfByKey(Component);
+	Batch.Instances->RemoveInstance(InstanceIndex);
+	Batch.Components.RemoveAt(InstanceIndex);
+}
+
+void UCSGInstanceSubsystem::UpdateInstance(UCSGStaticMeshComponent* Component)
+{
+	if (const int32* BatchIndex = ComponentBatches.Find(Component))
+	{
+		FCSGInstanceBatch& Batch = Batches[*BatchIndex];
+		Batch.Instances->UpdateInstanceTransform(Batch.Components.IndexOfByKey(Component),
+		                                         Component->GetComponentTransform(), true, true, true);
+	}
+}
+
+void UCSGInstanceSubsystem::Deinitialize()
+{
+	//the instance actor goes away together with the world
+	InstanceActor = nullptr;
+	Batches.Reset();
+	ComponentBatches.Reset();
+
+	Super::Deinitialize();
+}
+
+int32 UCSGInstanceSubsystem::FindOrAddBatch(UStaticMesh* Mesh, const TArray<TObjectPtr<UMaterialInterface>>& Materials)
+{
+	//there are only as many batches as distinct meshes, a linear search is fine
+	const int32 Found = Batches.IndexOfByPredicate([Mesh, &Materials](const FCSGInstanceBatch& Batch)
+	{
+		return Batch.Mesh == Mesh && Batch.Materials == Materials;
+	});
+	if (Found != INDEX_NONE)
+	{
+		return Found;
+	}
+
+	if (!InstanceActor)
+	{
+		FActorSpawnParameters Parameters;
+		Parameters.Name = MakeUniqueObjectName(GetWorld(), AActor::StaticClass(), TEXT("CSGInstances"));
+		Parameters.ObjectFlags = RF_Transient;
+		InstanceActor = GetWorld()->SpawnActor<AActor>(Parameters);
+
+		USceneComponent* Root = NewObject<USceneComponent>(InstanceActor, TEXT("Root"));
+		InstanceActor->SetRootComponent(Root);
+		Root->RegisterComponent();
+	}
+
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(InstanceActor);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetupAttachment(InstanceActor->GetRootComponent());
+	Instances->SetStaticMesh(Mesh);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	for (int32 i = 0; i < Materials.Num(); ++i)
+	{
+		Instances->SetMaterial(i, Materials[i]);
+	}
+	Instances->RegisterComponent();
+
+	FCSGInstanceBatch& Batch = Batches.AddDefaulted_GetRef();
+	Batch.Mesh = Mesh;
+	Batch.Materials = Materials;
+	Batch.Instances = Instances;
+	return Batches.Num() - 1;
+}
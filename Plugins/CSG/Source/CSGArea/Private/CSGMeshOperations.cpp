@@ -0,0 +1,1078 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGMeshOperations.h"
+
+#include "CSGStats.h"
+#include "ConstrainedDelaunay2.h"
+#include "DynamicMeshEditor.h"
+#include "MeshBoundaryLoops.h"
+#include "MeshConstraintsUtil.h"
+#include "MeshSimplification.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "CompGeom/ConvexHull3.h"
+#include "DynamicMesh/MeshNormals.h"
+#include "DynamicMesh/MeshTransforms.h"
+#include "Generators/CapsuleGenerator.h"
+#include "Generators/MinimalBoxMeshGenerator.h"
+#include "Generators/SphereGenerator.h"
+#include "Parameterization/DynamicMeshUVEditor.h"
+#include "Serialization/ArchiveLoadCompressedProxy.h"
+#include "Serialization/ArchiveSaveCompressedProxy.h"
+#include "Operations/MergeCoincidentMeshEdges.h"
+#include "Operations/MeshBoolean.h"
+#include "Operations/MeshPlaneCut.h"
+#include "Operations/MinimalHoleFiller.h"
+
+using namespace UE::Geometry;
+
+namespace
+{
+	/// @brief Appends Source to Target, both meshes have to use the same attributes
+	void AppendMesh(FDynamicMesh3& Target, FDynamicMesh3&& Source)
+	{
+		if (Target.TriangleCount() == 0)
+		{
+			Target = MoveTemp(Source);
+			return;
+		}
+
+		FDynamicMeshEditor Editor(&Target);
+		FMeshIndexMappings Mappings;
+		Editor.AppendMesh(&Source, Mappings);
+	}
+
+	bool AreasOverlap(const FCSGAreaSnapshot& A, const FCSGAreaSnapshot& B)
+	{
+		const double RadiusA = A.Radius * A.Transform.GetMaximumAxisScale();
+		const double RadiusB = B.Radius * B.Transform.GetMaximumAxisScale();
+
+		return FVector::DistSquared(A.Transform.GetLocation(), B.Transform.GetLocation()) <
+			FMath::Square(RadiusA + RadiusB);
+	}
+
+	/// @brief Groups areas whose spheres overlap, areas in different clusters never touch each other
+	TArray<TArray<int32>> ClusterAreas(const TArray<FCSGAreaSnapshot>& Areas)
+	{
+		TArray<int32> Parents;
+		Parents.SetNum(Areas.Num());
+		for (int32 i = 0; i < Areas.Num(); ++i)
+		{
+			Parents[i] = i;
+		}
+
+		auto FindRoot = [&Parents](int32 Index)
+		{
+			while (Parents[Index] != Index)
+			{
+				Parents[Index] = Parents[Parents[Index]];
+				Index = Parents[Index];
+			}
+			return Index;
+		};
+
+		for (int32 i = 0; i < Areas.Num(); ++i)
+		{
+			for (int32 j = i + 1; j < Areas.Num(); ++j)
+			{
+				if (AreasOverlap(Areas[i], Areas[j]))
+				{
+					Parents[FindRoot(i)] = FindRoot(j);
+				}
+			}
+		}
+
+		TArray<TArray<int32>> Clusters;
+		TMap<int32, int32> RootToCluster;
+		for (int32 i = 0; i < Areas.Num(); ++i)
+		{
+			const int32 Root = FindRoot(i);
+			if (const int32* Cluster = RootToCluster.Find(Root))
+			{
+				Clusters[*Cluster].Add(i);
+			}
+			else
+			{
+				RootToCluster.Add(Root, Clusters.Add({i}));
+			}
+		}
+
+		return Clusters;
+	}
+
+	/// @brief Unions the spheres of a cluster into a single cutter in world space
+	FDynamicMesh3 MakeClusterMesh(const TArray<FCSGAreaSnapshot>& Areas, const TArray<int32>& Cluster,
+	                              const FCSGRebuildInput& Input)
+	{
+		CSG_SCOPE_CYCLE_COUNTER(STAT_CSGUnionFold);
+
+		FDynamicMesh3 Cutter = CSG::MakeAreaMesh(Areas[Cluster[0]]);
+
+		//the cutters are tiny compared to the target, so unioning them first is cheap
+		for (int32 i = 1; i < Cluster.Num(); ++i)
+		{
+			const FCSGAreaSnapshot& Area = Areas[Cluster[i]];
+			if (Area.Cutter)
+			{
+				//the cached cutter is placed by the boolean itself, so it doesn't need to be copied
+				CSG::ApplyBoolean(Cutter, FTransform::Identity, *Area.Cutter, Area.Transform, CSG::EBooleanOp::Union);
+			}
+			else
+			{
+				const FDynamicMesh3 Sphere = CSG::MakeAreaMesh(Area);
+				CSG::ApplyBoolean(Cutter, FTransform::Identity, Sphere, FTransform::Identity, CSG::EBooleanOp::Union);
+			}
+		}
+
+		return Cutter;
+	}
+
+	/// Drops the areas that don't touch the mesh
+	///
+	/// @return Whether one of the areas contains the whole mesh
+	bool FilterAreas(const FDynamicMesh3& Mesh, const TArray<FCSGAreaSnapshot>& Areas, const FCSGRebuildInput& Input,
+	                 TArray<FCSGAreaSnapshot>& OutAreas)
+	{
+		const FAxisAlignedBox3d Bounds = Mesh.GetBounds(true);
+		for (const FCSGAreaSnapshot& Area : Areas)
+		{
+			switch (CSG::ClassifyBounds(Bounds, Input.ComponentTransform, Area))
+			{
+			case CSG::EAreaCoverage::Contains:
+				return true;
+			case CSG::EAreaCoverage::Partial:
+				OutAreas.Add(Area);
+				break;
+			default:
+				break;
+			}
+		}
+		return false;
+	}
+
+	/// @brief Intersects the mesh with the union of all areas, running at most one boolean on the full mesh
+	void IntersectAreas(FDynamicMesh3& Mesh, const TArray<FCSGAreaSnapshot>& AllAreas, const FCSGRebuildInput& Input)
+	{
+		//an area containing the whole mesh keeps all of it
+		TArray<FCSGAreaSnapshot> Areas;
+		if (FilterAreas(Mesh, AllAreas, Input, Areas))
+		{
+			return;
+		}
+
+		FDynamicMesh3 Output;
+		Output.EnableMatchingAttributes(Mesh);
+
+		FDynamicMesh3 Cutter;
+
+		for (const TArray<int32>& Cluster : ClusterAreas(Areas))
+		{
+			//clusters never touch, so their pieces can be appended without a union
+			FDynamicMesh3 Piece;
+			if (Cluster.Num() == 1 &&
+				((Input.bAnalyticSphereCut &&
+						CSG::TrySphereCut(Mesh, Input.ComponentTransform, Areas[Cluster[0]],
+						                  CSG::EBooleanOp::Intersection, Areas[Cluster[0]].MaterialID, Piece)) ||
+					(Input.bAnalyticConvexCut &&
+						CSG::TryConvexCut(Mesh, Input.ComponentTransform, Areas[Cluster[0]],
+						                  CSG::EBooleanOp::Intersection, Areas[Cluster[0]].MaterialID, Piece))))
+			{
+				AppendMesh(Output, MoveTemp(Piece));
+				continue;
+			}
+
+			AppendMesh(Cutter, MakeClusterMesh(Areas, Cluster, Input));
+		}
+
+		if (Cutter.TriangleCount() > 0)
+		{
+			FDynamicMesh3 Piece = Mesh;
+			CSG::ApplyBoolean(Piece, Input.ComponentTransform, Cutter, FTransform::Identity,
+			                  CSG::EBooleanOp::Intersection);
+			AppendMesh(Output, MoveTemp(Piece));
+		}
+
+		Mesh = MoveTemp(Output);
+	}
+
+	/// @brief Subtracts the union of all areas from the mesh, running at most one boolean on the full mesh
+	void SubtractAreas(FDynamicMesh3& Mesh, const TArray<FCSGAreaSnapshot>& AllAreas, const FCSGRebuildInput& Input)
+	{
+		//an area containing the whole mesh removes all of it
+		TArray<FCSGAreaSnapshot> Areas;
+		if (FilterAreas(Mesh, AllAreas, Input, Areas))
+		{
+			FDynamicMesh3 Empty;
+			Empty.EnableMatchingAttributes(Mesh);
+			Mesh = MoveTemp(Empty);
+			return;
+		}
+
+		FDynamicMesh3 Cutter;
+
+		for (const TArray<int32>& Cluster : ClusterAreas(Areas))
+		{
+			FDynamicMesh3 Result;
+			if (Cluster.Num() == 1 && Input.bAnalyticSphereCut &&
+				CSG::TrySphereCut(Mesh, Input.ComponentTransform, Areas[Cluster[0]],
+				                  CSG::EBooleanOp::Subtract, Areas[Cluster[0]].MaterialID, Result))
+			{
+				Mesh = MoveTemp(Result);
+				continue;
+			}
+
+			AppendMesh(Cutter, MakeClusterMesh(Areas, Cluster, Input));
+		}
+
+		if (Cutter.TriangleCount() > 0)
+		{
+			CSG::ApplyBoolean(Mesh, Input.ComponentTransform, Cutter, FTransform::Identity, CSG::EBooleanOp::Subtract);
+		}
+	}
+
+	void EvaluateAreas(FDynamicMesh3& Mesh, const TArray<FCSGAreaSnapshot>& Areas, const FCSGRebuildInput& Input)
+	{
+		if (Input.bReverse)
+		{
+			SubtractAreas(Mesh, Areas, Input);
+		}
+		else
+		{
+			IntersectAreas(Mesh, Areas, Input);
+		}
+	}
+
+	/// @brief Maximum depth of the chunk split, a last resort for meshes the plane cut doesn't make smaller
+	constexpr int32 MaxChunkDepth = 16;
+
+	/// @brief Material ID of the faces closing the chunks, material IDs of the component are never negative
+	constexpr int32 ChunkSeamMaterialID = -1;
+
+	/// @brief Keeps the part of the mesh behind the plane and closes the opening with faces tagged as seam
+	void CutHalf(FDynamicMesh3& Mesh, const FVector3d& Origin, const FVector3d& Normal)
+	{
+		FMeshPlaneCut Cut(&Mesh, Origin, Normal);
+		Cut.Cut();
+
+		TSet<int32> CutTriangles;
+		for (const int32 Triangle : Mesh.TriangleIndicesItr())
+		{
+			CutTriangles.Add(Triangle);
+		}
+
+		Cut.HoleFill(ConstrainedDelaunayTriangulate<double>, true);
+
+		//the cuts keep the material IDs, so the seam faces can still be told apart after the areas cut the chunk
+		FDynamicMeshMaterialAttribute* MaterialIDs = Mesh.Attributes()->GetMaterialID();
+		for (const int32 Triangle : Mesh.TriangleIndicesItr())
+		{
+			if (!CutTriangles.Contains(Triangle))
+			{
+				MaterialIDs->SetValue(Triangle, ChunkSeamMaterialID);
+			}
+		}
+	}
+
+	/// Removes the faces closing the chunks and welds the chunks back together along their seams,
+	/// the areas can add vertices to one side of a seam only, so the open edges get split at the vertices
+	/// of the other side first
+	void WeldChunkSeams(FDynamicMesh3& Mesh)
+	{
+		FDynamicMeshMaterialAttribute* MaterialIDs = Mesh.HasAttributes() ? Mesh.Attributes()->GetMaterialID() : nullptr;
+		if (!MaterialIDs)
+		{
+			return;
+		}
+
+		TArray<int32> SeamTriangles;
+		for (const int32 Triangle : Mesh.TriangleIndicesItr())
+		{
+			if (MaterialIDs->GetValue(Triangle) == ChunkSeamMaterialID)
+			{
+				SeamTriangles.Add(Triangle);
+			}
+		}
+
+		if (SeamTriangles.IsEmpty())
+		{
+			return;
+		}
+
+		for (const int32 Triangle : SeamTriangles)
+		{
+			Mesh.RemoveTriangle(Triangle, true, false);
+		}
+
+		const double Tolerance = FMath::Max(1e-5 * Mesh.GetBounds().MaxDim(), FMathd::ZeroTolerance);
+
+		TArray<int32> OpenEdges;
+		TSet<int32> OpenVertices;
+		double OpenLength = 0.0;
+		for (const int32 Edge : Mesh.EdgeIndicesItr())
+		{
+			if (Mesh.IsBoundaryEdge(Edge))
+			{
+				const FIndex2i EdgeVertices = Mesh.GetEdgeV(Edge);
+				OpenEdges.Add(Edge);
+				OpenVertices.Add(EdgeVertices.A);
+				OpenVertices.Add(EdgeVertices.B);
+				OpenLength += FVector3d::Distance(Mesh.GetVertex(EdgeVertices.A), Mesh.GetVertex(EdgeVertices.B));
+			}
+		}
+
+		if (OpenEdges.IsEmpty())
+		{
+			return;
+		}
+
+		//open vertices by cell, the cells are about as large as an open edge
+		const double CellSize = FMath::Max(OpenLength / OpenEdges.Num(), 4.0 * Tolerance);
+		auto ToCell = [CellSize](const FVector3d& Point)
+		{
+			return FIntVector(FMath::FloorToInt32(Point.X / CellSize), FMath::FloorToInt32(Point.Y / CellSize),
+			                  FMath::FloorToInt32(Point.Z / CellSize));
+		};
+
+		TMultiMap<FIntVector, int32> Cells;
+		for (const int32 Vertex : OpenVertices)
+		{
+			Cells.Add(ToCell(Mesh.GetVertex(Vertex)), Vertex);
+		}
+
+		constexpr int32 MaxSearchCells = 4096;
+
+		TArray<int32> Candidates;
+		TArray<TPair<double, int32>> Splits;
+		for (const int32 Edge : OpenEdges)
+		{
+			const FIndex2i EdgeVertices = Mesh.GetEdgeV(Edge);
+			const FVector3d A = Mesh.GetVertex(EdgeVertices.A);
+			const FVector3d B = Mesh.GetVertex(EdgeVertices.B);
+			const FVector3d AB = B - A;
+			const double LengthSquared = AB.SquaredLength();
+			if (LengthSquared < FMath::Square(2.0 * Tolerance))
+			{
+				continue;
+			}
+
+			Candidates.Reset();
+			const FIntVector MinCell = ToCell(A.ComponentMin(B) - FVector3d(Tolerance));
+			const FIntVector MaxCell = ToCell(A.ComponentMax(B) + FVector3d(Tolerance));
+			const FIntVector CellCount = MaxCell - MinCell + FIntVector(1);
+			if (static_cast<int64>(CellCount.X) * CellCount.Y * CellCount.Z > MaxSearchCells)
+			{
+				Candidates = OpenVertices.Array();
+			}
+			else
+			{
+				for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+				{
+					for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+					{
+						for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+						{
+							Cells.MultiFind(FIntVector(X, Y, Z), Candidates);
+						}
+					}
+				}
+			}
+
+			Splits.Reset();
+			for (const int32 Vertex : Candidates)
+			{
+				const FVector3d Point = Mesh.GetVertex(Vertex);
+				const double T = (Point - A).Dot(AB) / LengthSquared;
+				if (Vertex != EdgeVertices.A && Vertex != EdgeVertices.B &&
+					FVector3d::DistSquared(Point, A + AB * T) < FMath::Square(Tolerance) &&
+					FVector3d::DistSquared(Point, A) > FMath::Square(Tolerance) &&
+					FVector3d::DistSquared(Point, B) > FMath::Square(Tolerance) && T > 0.0 && T < 1.0)
+				{
+					Splits.Emplace(T, Vertex);
+				}
+			}
+
+			//a split keeps the edge running from its first vertex to the new one, so the splits go from the far end
+			Splits.Sort([](const TPair<double, int32>& L, const TPair<double, int32>& R)
+			{
+				return L.Key > R.Key;
+			});
+
+			for (const TPair<double, int32>& Split : Splits)
+			{
+				const FIndex2i Current = Mesh.GetEdgeV(Edge);
+				const FVector3d Start = Mesh.GetVertex(Current.A);
+				const FVector3d End = Mesh.GetVertex(Current.B);
+				const FVector3d Point = Mesh.GetVertex(Split.Value);
+				const double Alpha = FMath::Clamp((Point - Start).Dot(End - Start) / (End - Start).SquaredLength(),
+				                                  0.0, 1.0);
+
+				FDynamicMesh3::FEdgeSplitInfo SplitInfo;
+				if (Mesh.SplitEdge(Edge, SplitInfo, Alpha) == EMeshResult::Ok)
+				{
+					Mesh.SetVertex(SplitInfo.NewVertex, Point);
+				}
+			}
+		}
+
+		FMergeCoincidentMeshEdges Welder(&Mesh);
+		Welder.MergeVertexTolerance = Tolerance;
+		Welder.MergeSearchTolerance = 2.0 * Tolerance;
+		Welder.Apply();
+	}
+
+	/// @brief Evaluates a mesh chunk by chunk, only re-evaluating chunks for which the touching areas changed
+	void EvaluateChunks(FDynamicMesh3& Mesh, FCSGChunkCache& Cache, const FCSGRebuildInput& Input)
+	{
+		if (!Cache.bBuilt)
+		{
+			CSG::SplitIntoChunks(Mesh, Input.MaxChunkTriangles, Cache.Chunks);
+			Cache.bBuilt = true;
+		}
+
+		//the chunks are in local space, so moving the component moves every area relative to them
+		if (Cache.bReverse != Input.bReverse || !Cache.ComponentTransform.Equals(Input.ComponentTransform))
+		{
+			for (FCSGChunk& Chunk : Cache.Chunks)
+			{
+				Chunk.bHasResult = false;
+			}
+			Cache.bReverse = Input.bReverse;
+			Cache.ComponentTransform = Input.ComponentTransform;
+		}
+
+		TArray<FVector3d> LocalCenters;
+		TArray<double> LocalRadii;
+		const double ComponentScale = FMath::Max(Input.ComponentTransform.GetMinimumAxisScale(), FMathd::ZeroTolerance);
+		for (const FCSGAreaSnapshot& Area : Input.Areas)
+		{
+			LocalCenters.Add(Input.ComponentTransform.InverseTransformPosition(Area.Transform.GetLocation()));
+			LocalRadii.Add(Area.Radius * Area.Transform.GetMaximumAxisScale() / ComponentScale);
+		}
+
+		int32 SourceTriangleCount = 0;
+		for (const FCSGChunk& Chunk : Cache.Chunks)
+		{
+			SourceTriangleCount += Chunk.Source.TriangleCount();
+		}
+
+		//the source mesh is only passed in while the chunks get built
+		FDynamicMesh3 Output;
+		Output.EnableMatchingAttributes(Cache.Chunks.IsEmpty() ? Mesh : Cache.Chunks[0].Source);
+
+		for (FCSGChunk& Chunk : Cache.Chunks)
+		{
+			TArray<FCSGAreaSnapshot> Touching;
+			for (int32 i = 0; i < Input.Areas.Num(); ++i)
+			{
+				if (Chunk.Bounds.DistanceSquared(LocalCenters[i]) < FMath::Square(LocalRadii[i]))
+				{
+					Touching.Add(Input.Areas[i]);
+				}
+			}
+
+			if (!Chunk.bHasResult || !CSG::AreasEqual(Chunk.AppliedAreas, Touching))
+			{
+				Chunk.Result = Chunk.Source;
+				EvaluateAreas(Chunk.Result, Touching, Input);
+
+				if (Input.PostProcess.bEnabled)
+				{
+					//each chunk gets the share of the budget matching its share of the source mesh
+					const int32 ChunkBudget = static_cast<int32>(static_cast<int64>(Input.PostProcess.TriangleBudget) *
+						Chunk.Source.TriangleCount() / FMath::Max(1, SourceTriangleCount));
+					CSG::PostProcess(Chunk.Result, Input.PostProcess, ChunkBudget, Input.CSGMaterialID);
+				}
+				Chunk.AppliedAreas = MoveTemp(Touching);
+				Chunk.bHasResult = true;
+			}
+
+			if (Chunk.Result.TriangleCount() > 0)
+			{
+				FDynamicMesh3 Copy = Chunk.Result;
+				AppendMesh(Output, MoveTemp(Copy));
+			}
+		}
+
+		//the chunk results still carry the faces closing them, back to back at every seam
+		WeldChunkSeams(Output);
+
+		Mesh = MoveTemp(Output);
+	}
+
+	/// Subtracts only the areas added since the last rebuild from the previous result
+	///
+	/// @return False when an area moved or got removed, the mesh has to be rebuilt from the source then
+	bool TryEvaluateIncremental(FDynamicMesh3& Mesh, const FCSGIncrementalCache& Cache, const FCSGRebuildInput& Input)
+	{
+		if (!Cache.bValid || !Input.bReverse || !Cache.ComponentTransform.Equals(Input.ComponentTransform))
+		{
+			return false;
+		}
+
+		TArray<FCSGAreaSnapshot> Added;
+		int32 Matched = 0;
+		for (const FCSGAreaSnapshot& Area : Input.Areas)
+		{
+			const FCSGAreaSnapshot* Applied = Cache.AppliedAreas.FindByPredicate([&Area](const FCSGAreaSnapshot& Other)
+			{
+				return Other.Component == Area.Component;
+			});
+
+			if (!Applied)
+			{
+				Added.Add(Area);
+			}
+			else if (Applied->Equals(Area))
+			{
+				++Matched;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		if (Matched != Cache.AppliedAreas.Num())
+		{
+			return false;
+		}
+
+		Mesh = Cache.Result;
+		if (!Added.IsEmpty())
+		{
+			SubtractAreas(Mesh, Added, Input);
+		}
+		return true;
+	}
+
+	void EvaluateMesh(FDynamicMesh3& Mesh, FCSGSdfCache* Sdf, FCSGChunkCache* Chunks,
+	                  FCSGIncrementalCache* Incremental, const FCSGRebuildInput& Input)
+	{
+		if (Sdf)
+		{
+			CSG::EvaluateSdf(Mesh, *Sdf, Input);
+			if (Input.PostProcess.bEnabled)
+			{
+				CSG::PostProcess(Mesh, Input.PostProcess, Input.PostProcess.TriangleBudget, Input.CSGMaterialID);
+			}
+			return;
+		}
+
+		if (Chunks && Input.MaxChunkTriangles > 0)
+		{
+			EvaluateChunks(Mesh, *Chunks, Input);
+			return;
+		}
+
+		const bool bIncremental = Incremental && Input.bIncremental && Input.bReverse;
+		if (!bIncremental || !TryEvaluateIncremental(Mesh, *Incremental, Input))
+		{
+			EvaluateAreas(Mesh, Input.Areas, Input);
+		}
+
+		if (Input.PostProcess.bEnabled)
+		{
+			CSG::PostProcess(Mesh, Input.PostProcess, Input.PostProcess.TriangleBudget, Input.CSGMaterialID);
+		}
+
+		if (bIncremental)
+		{
+			Incremental->Result = Mesh;
+			Incremental->AppliedAreas = Input.Areas;
+			Incremental->ComponentTransform = Input.ComponentTransform;
+			Incremental->bValid = true;
+		}
+	}
+
+	/// @brief Collapses needles and flips caps, triangles thinner than the tolerance only add slivers along the cut
+	void RemoveDegenerateTriangles(FDynamicMesh3& Mesh, double Tolerance)
+	{
+		TArray<int32> Triangles;
+		for (const int32 Triangle : Mesh.TriangleIndicesItr())
+		{
+			Triangles.Add(Triangle);
+		}
+
+		for (const int32 Triangle : Triangles)
+		{
+			if (!Mesh.IsTriangle(Triangle))
+			{
+				continue;
+			}
+
+			const FIndex3i Edges = Mesh.GetTriEdges(Triangle);
+			int32 Shortest = 0;
+			int32 Longest = 0;
+			double Lengths[3];
+			for (int32 i = 0; i < 3; ++i)
+			{
+				const FIndex2i EdgeVertices = Mesh.GetEdgeV(Edges[i]);
+				Lengths[i] = FVector3d::Distance(Mesh.GetVertex(EdgeVertices.A), Mesh.GetVertex(EdgeVertices.B));
+				Shortest = Lengths[i] < Lengths[Shortest] ? i : Shortest;
+				Longest = Lengths[i] > Lengths[Longest] ? i : Longest;
+			}
+
+			const double Height = 2.0 * Mesh.GetTriArea(Triangle) / FMath::Max(Lengths[Longest], FMathd::ZeroTolerance);
+			if (Height >= Tolerance)
+			{
+				continue;
+			}
+
+			if (Lengths[Shortest] < Tolerance)
+			{
+				FIndex2i EdgeVertices = Mesh.GetEdgeV(Edges[Shortest]);
+				if (Mesh.IsBoundaryVertex(EdgeVertices.B))
+				{
+					Swap(EdgeVertices.A, EdgeVertices.B);
+				}
+
+				FDynamicMesh3::FEdgeCollapseInfo CollapseInfo;
+				Mesh.CollapseEdge(EdgeVertices.A, EdgeVertices.B, CollapseInfo);
+			}
+			else if (!Mesh.IsBoundaryEdge(Edges[Longest]))
+			{
+				FDynamicMesh3::FEdgeFlipInfo FlipInfo;
+				Mesh.FlipEdge(Edges[Longest], FlipInfo);
+			}
+		}
+	}
+}
+
+bool FCSGAreaSnapshot::Equals(const FCSGAreaSnapshot& Other) const
+{
+	return Component == Other.Component && Cutter == Other.Cutter && MaterialID == Other.MaterialID &&
+		Shape == Other.Shape && Extent.Equals(Other.Extent) && FMath::IsNearlyEqual(Radius, Other.Radius) &&
+		Transform.Equals(Other.Transform);
+}
+
+void CSG::Simplify(FDynamicMesh3& Mesh, int32 TriangleCount)
+{
+	if (Mesh.TriangleCount() <= TriangleCount)
+	{
+		return;
+	}
+
+	FVolPresMeshSimplification Simplifier(&Mesh);
+	Simplifier.bAllowSeamCollapse = true;
+	Simplifier.SimplifyToTriangleCount(TriangleCount);
+}
+
+void CSG::PostProcess(FDynamicMesh3& Mesh, const FCSGPostProcessSettings& Settings, int32 TriangleBudget,
+                      int32 CutMaterialID)
+{
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGPostProcess);
+
+	//the boolean leaves the seams along the cut open
+	FMergeCoincidentMeshEdges Welder(&Mesh);
+	Welder.MergeVertexTolerance = Settings.WeldTolerance;
+	Welder.MergeSearchTolerance = 2.0 * Settings.WeldTolerance;
+	Welder.Apply();
+
+	RemoveDegenerateTriangles(Mesh, Settings.WeldTolerance);
+
+	if (TriangleBudget <= 0 || Mesh.TriangleCount() <= TriangleBudget)
+	{
+		return;
+	}
+
+	FMeshConstraints Constraints;
+	FMeshConstraintsUtil::ConstrainAllBoundariesAndSeams(Constraints, Mesh, EEdgeRefineFlags::FullyConstrained,
+	                                                     EEdgeRefineFlags::NoConstraint, EEdgeRefineFlags::NoFlip);
+
+	//only the cut faces and the rings around them get simplified, that's where the boolean adds triangles
+	const FDynamicMeshMaterialAttribute* MaterialIDs = Mesh.HasAttributes() ? Mesh.Attributes()->GetMaterialID() : nullptr;
+	if (MaterialIDs)
+	{
+		TBitArray<> Region(false, Mesh.MaxVertexID());
+		for (const int32 Triangle : Mesh.TriangleIndicesItr())
+		{
+			if (MaterialIDs->GetValue(Triangle) >= CutMaterialID)
+			{
+				const FIndex3i Vertices = Mesh.GetTriangle(Triangle);
+				Region[Vertices.A] = Region[Vertices.B] = Region[Vertices.C] = true;
+			}
+		}
+
+		for (int32 Ring = 0; Ring < Settings.CutRegionRings; ++Ring)
+		{
+			TArray<int32> Grown;
+			for (const int32 Vertex : Mesh.VertexIndicesItr())
+			{
+				if (Region[Vertex])
+				{
+					Mesh.EnumerateVertexVertices(Vertex, [&Region, &Grown](int32 Neighbour)
+					{
+						if (!Region[Neighbour])
+						{
+							Grown.Add(Neighbour);
+						}
+					});
+				}
+			}
+			for (const int32 Vertex : Grown)
+			{
+				Region[Vertex] = true;
+			}
+		}
+
+		for (const int32 Edge : Mesh.EdgeIndicesItr())
+		{
+			const FIndex2i Vertices = Mesh.GetEdgeV(Edge);
+			if (!Region[Vertices.A] || !Region[Vertices.B])
+			{
+				Constraints.SetOrUpdateEdgeConstraint(Edge, FEdgeConstraint::FullyConstrained());
+			}
+		}
+		for (const int32 Vertex : Mesh.VertexIndicesItr())
+		{
+			if (!Region[Vertex])
+			{
+				Constraints.SetOrUpdateVertexConstraint(Vertex, FVertexConstraint::FullyConstrained());
+			}
+		}
+	}
+
+	FQEMSimplification Simplifier(&Mesh);
+	Simplifier.SetExternalConstraints(MoveTemp(Constraints));
+	Simplifier.SimplifyToTriangleCount(TriangleBudget);
+}
+
+void CSG::SaveMesh(const FDynamicMesh3& Mesh, TArray<uint8>& OutData)
+{
+	OutData.Reset();
+
+	FArchiveSaveCompressedProxy Compressor(OutData, NAME_Zlib);
+	//saving only reads from the mesh
+	Compressor << const_cast<FDynamicMesh3&>(Mesh);
+	Compressor.Flush();
+}
+
+bool CSG::LoadMesh(const TArray<uint8>& Data, FDynamicMesh3& OutMesh)
+{
+	if (Data.IsEmpty())
+	{
+		return false;
+	}
+
+	FArchiveLoadCompressedProxy Decompressor(Data, NAME_Zlib);
+	Decompressor << OutMesh;
+	return !Decompressor.IsError();
+}
+
+bool CSG::AreasEqual(const TArray<FCSGAreaSnapshot>& A, const TArray<FCSGAreaSnapshot>& B)
+{
+	if (A.Num() != B.Num())
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < A.Num(); ++i)
+	{
+		if (!A[i].Equals(B[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CSG::SplitIntoChunks(const FDynamicMesh3& Mesh, int32 MaxChunkTriangles, TArray<FCSGChunk>& OutChunks)
+{
+	OutChunks.Reset();
+
+	TArray<TPair<FDynamicMesh3, int32>> Pending;
+	Pending.Emplace(Mesh, 0);
+
+	//the faces closing the chunks are tagged by their material ID
+	FDynamicMesh3& Root = Pending[0].Key;
+	if (!Root.HasAttributes())
+	{
+		Root.EnableAttributes();
+	}
+	if (!Root.Attributes()->HasMaterialID())
+	{
+		Root.Attributes()->EnableMaterialID();
+	}
+
+	while (!Pending.IsEmpty())
+	{
+		TPair<FDynamicMesh3, int32> Entry = Pending.Pop();
+		FDynamicMesh3& Part = Entry.Key;
+		const int32 Depth = Entry.Value;
+		const FAxisAlignedBox3d Bounds = Part.GetBounds(true);
+
+		if (Part.TriangleCount() > MaxChunkTriangles && Depth < MaxChunkDepth)
+		{
+			//halve along the longest axis of the part
+			const FVector3d Extents = Bounds.Diagonal();
+			const int32 Axis = Extents.X >= Extents.Y && Extents.X >= Extents.Z ? 0 : (Extents.Y >= Extents.Z ? 1 : 2);
+			FVector3d Normal = FVector3d::Zero();
+			Normal[Axis] = 1.0;
+
+			FDynamicMesh3 Front = Part;
+			FDynamicMesh3 Back = Part;
+			CutHalf(Front, Bounds.Center(), Normal);
+			CutHalf(Back, Bounds.Center(), -Normal);
+
+			if (Front.TriangleCount() < Part.TriangleCount() && Back.TriangleCount() < Part.TriangleCount())
+			{
+				if (Front.TriangleCount() > 0)
+				{
+					Pending.Emplace(MoveTemp(Front), Depth + 1);
+				}
+				if (Back.TriangleCount() > 0)
+				{
+					Pending.Emplace(MoveTemp(Back), Depth + 1);
+				}
+				continue;
+			}
+		}
+
+		FCSGChunk& Chunk = OutChunks.AddDefaulted_GetRef();
+		Chunk.Source = MoveTemp(Part);
+		Chunk.Bounds = Bounds;
+	}
+}
+
+FDynamicMesh3 CSG::MakeSphereCutter(double Radius, int32 Steps, int32 MaterialID)
+{
+	FBoxSphereGenerator SphereGenerator;
+	SphereGenerator.Radius = FMath::Max(static_cast<double>(FMathf::ZeroTolerance), Radius);
+	SphereGenerator.EdgeVertices = FIndex3i(Steps, Steps, Steps);
+	SphereGenerator.Generate();
+
+	FDynamicMesh3 Mesh(&SphereGenerator);
+	AssignMaterialID(Mesh, MaterialID);
+
+	return Mesh;
+}
+
+FDynamicMesh3 CSG::MakeBoxCutter(const FVector& Extent, int32 MaterialID)
+{
+	FMinimalBoxMeshGenerator BoxGenerator;
+	BoxGenerator.Box = FOrientedBox3d(FVector3d::Zero(), FVector3d(Extent).ComponentMax(FVector3d(FMathf::ZeroTolerance)));
+	BoxGenerator.Generate();
+
+	FDynamicMesh3 Mesh(&BoxGenerator);
+	AssignMaterialID(Mesh, MaterialID);
+
+	return Mesh;
+}
+
+FDynamicMesh3 CSG::MakeCapsuleCutter(double Radius, double HalfHeight, int32 Steps, int32 MaterialID)
+{
+	Radius = FMath::Max(static_cast<double>(FMathf::ZeroTolerance), Radius);
+
+	FCapsuleGenerator CapsuleGenerator;
+	CapsuleGenerator.Radius = Radius;
+	CapsuleGenerator.SegmentLength = FMath::Max(0.0, 2.0 * (HalfHeight - Radius));
+	CapsuleGenerator.NumHemisphereArcSteps = FMath::Max(2, Steps);
+	CapsuleGenerator.NumCircleSteps = FMath::Max(3, Steps * 4);
+	CapsuleGenerator.Generate();
+
+	FDynamicMesh3 Mesh(&CapsuleGenerator);
+	AssignMaterialID(Mesh, MaterialID);
+
+	//the generator starts the capsule at the origin
+	MeshTransforms::Translate(Mesh, -Mesh.GetBounds(true).Center());
+
+	return Mesh;
+}
+
+FDynamicMesh3 CSG::MakeConvexCutter(const FDynamicMesh3& Source, int32 MaterialID)
+{
+	TArray<FVector3d> Points;
+	Points.Reserve(Source.VertexCount());
+	for (const int32 Vertex : Source.VertexIndicesItr())
+	{
+		Points.Add(Source.GetVertex(Vertex));
+	}
+
+	FDynamicMesh3 Mesh;
+	FConvexHull3d Hull;
+	if (!Hull.Solve(TArrayView<const FVector3d>(Points)))
+	{
+		return Mesh;
+	}
+
+	//only the points on the hull get a vertex, the ones inside it would be carried into every boolean
+	TMap<int32, int32> PointToVertex;
+	auto GetVertex = [&Mesh, &Points, &PointToVertex](int32 Point)
+	{
+		if (const int32* Vertex = PointToVertex.Find(Point))
+		{
+			return *Vertex;
+		}
+		return PointToVertex.Add(Point, Mesh.AppendVertex(Points[Point]));
+	};
+
+	for (const FIndex3i& Triangle : Hull.GetTriangles())
+	{
+		Mesh.AppendTriangle(GetVertex(Triangle.A), GetVertex(Triangle.B), GetVertex(Triangle.C));
+	}
+
+	Mesh.EnableAttributes();
+	FMeshNormals::InitializeOverlayToPerTriangleNormals(Mesh.Attributes()->PrimaryNormals());
+	FDynamicMeshUVEditor UVEditor(&Mesh, 0, true);
+	UVEditor.SetPerTriangleUVs();
+	AssignMaterialID(Mesh, MaterialID);
+
+	return Mesh;
+}
+
+void CSG::AssignMaterialID(FDynamicMesh3& Mesh, int32 MaterialID)
+{
+	if (!Mesh.HasAttributes())
+	{
+		Mesh.EnableAttributes();
+	}
+	Mesh.Attributes()->EnableMaterialID();
+
+	FDynamicMeshMaterialAttribute* MaterialIDs = Mesh.Attributes()->GetMaterialID();
+	for (const int32 Triangle : Mesh.TriangleIndicesItr())
+	{
+		MaterialIDs->SetValue(Triangle, MaterialID);
+	}
+}
+
+CSG::EAreaCoverage CSG::ClassifyBounds(const FAxisAlignedBox3d& Bounds, const FTransform& ComponentTransform,
+                                       const FCSGAreaSnapshot& Area)
+{
+	if (Bounds.IsEmpty())
+	{
+		return EAreaCoverage::Disjoint;
+	}
+
+	//bounding sphere of the area in the local space of the bounds
+	const double ComponentScale = FMath::Max(ComponentTransform.GetMinimumAxisScale(), FMathd::ZeroTolerance);
+	const FVector3d Center = ComponentTransform.InverseTransformPosition(Area.Transform.GetLocation());
+	const double Radius = Area.Radius * Area.Transform.GetMaximumAxisScale() / ComponentScale;
+	if (Bounds.DistanceSquared(Center) >= Radius * Radius)
+	{
+		return EAreaCoverage::Disjoint;
+	}
+
+	//the primitive shapes are convex, so they contain the bounds when they contain all of its corners
+	auto IsInside = [&Area](const FVector3d& Point)
+	{
+		switch (Area.Shape)
+		{
+		case ECSGAreaShape::Sphere:
+			return Point.SquaredLength() <= FMath::Square(static_cast<double>(Area.Radius));
+		case ECSGAreaShape::Box:
+			return FMath::Abs(Point.X) <= Area.Extent.X && FMath::Abs(Point.Y) <= Area.Extent.Y &&
+				FMath::Abs(Point.Z) <= Area.Extent.Z;
+		case ECSGAreaShape::Capsule:
+			{
+				const double SegmentHalfLength = FMath::Max(0.0, Area.Extent.Z - Area.Extent.X);
+				const FVector3d Closest(0.0, 0.0, FMath::Clamp(Point.Z, -SegmentHalfLength, SegmentHalfLength));
+				return FVector3d::DistSquared(Point, Closest) <= FMath::Square(Area.Extent.X);
+			}
+		default:
+			return false;
+		}
+	};
+
+	for (int32 Corner = 0; Corner < 8; ++Corner)
+	{
+		const FVector World = ComponentTransform.TransformPosition(Bounds.GetCorner(Corner));
+		if (!IsInside(Area.Transform.InverseTransformPosition(World)))
+		{
+			return EAreaCoverage::Partial;
+		}
+	}
+
+	return EAreaCoverage::Contains;
+}
+
+FDynamicMesh3 CSG::MakeAreaMesh(const FCSGAreaSnapshot& Area)
+{
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGGenerateCutter);
+
+	FDynamicMesh3 Mesh = Area.Cutter ? *Area.Cutter : MakeSphereCutter(Area.Radius, DefaultSphereSteps, Area.MaterialID);
+	MeshTransforms::ApplyTransform(Mesh, static_cast<FTransformSRT3d>(Area.Transform), true);
+
+	return Mesh;
+}
+
+void CSG::ApplyBoolean(FDynamicMesh3& TargetMesh, const FTransform& TargetTransform,
+                       const FDynamicMesh3& ToolMesh, const FTransform& ToolTransform, EBooleanOp Operation)
+{
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGBoolean);
+
+	FMeshBoolean::EBooleanOp Op = FMeshBoolean::EBooleanOp::Union;
+	switch (Operation)
+	{
+	case EBooleanOp::Union:
+		Op = FMeshBoolean::EBooleanOp::Union;
+		break;
+	case EBooleanOp::Intersection:
+		Op = FMeshBoolean::EBooleanOp::Intersect;
+		break;
+	case EBooleanOp::Subtract:
+		Op = FMeshBoolean::EBooleanOp::Difference;
+		break;
+	}
+
+	FDynamicMesh3 Result;
+	FMeshBoolean MeshBoolean(&TargetMesh, static_cast<FTransformSRT3d>(TargetTransform),
+	                         &ToolMesh, static_cast<FTransformSRT3d>(ToolTransform), &Result, Op);
+	MeshBoolean.bPutResultInInputSpace = false;
+	MeshBoolean.bSimplifyAlongNewEdges = true;
+	MeshBoolean.bWeldSharedEdges = false;
+	MeshBoolean.bTrackAllNewEdges = true;
+
+	//a failed boolean still produces a result, but it can have holes along the cut
+	if (!MeshBoolean.Compute())
+	{
+		FMeshBoundaryLoops OpenBoundary(&Result, false);
+		TSet<int> ConsiderEdges(MeshBoolean.CreatedBoundaryEdges);
+		OpenBoundary.EdgeFilterFunc = [&ConsiderEdges](int EdgeID) { return ConsiderEdges.Contains(EdgeID); };
+		OpenBoundary.Compute();
+
+		for (FEdgeLoop& Loop : OpenBoundary.Loops)
+		{
+			FMinimalHoleFiller Filler(&Result, Loop);
+			Filler.Fill();
+		}
+	}
+
+	MeshTransforms::ApplyTransform(Result, MeshBoolean.ResultTransform, true);
+	MeshTransforms::ApplyTransformInverse(Result, static_cast<FTransformSRT3d>(TargetTransform), true);
+
+	TargetMesh = MoveTemp(Result);
+}
+
+void CSG::Evaluate(FCSGRebuildInput& Input, FCSGRebuildResult& OutResult)
+{
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGEvaluate);
+
+	const double Start = FPlatformTime::Seconds();
+	OutResult.AreaCount = Input.Areas.Num();
+	OutResult.InputTriangleCount = (Input.bEvaluateVisual ? Input.VisualMesh.TriangleCount() : 0) +
+		(Input.bEvaluateCollision ? Input.CollisionMesh.TriangleCount() : 0);
+
+	if (Input.bEvaluateVisual)
+	{
+		EvaluateMesh(Input.VisualMesh, Input.VisualSdf.Get(), Input.VisualChunks.Get(), Input.VisualIncremental.Get(),
+		             Input);
+		OutResult.VisualMesh = MoveTemp(Input.VisualMesh);
+		OutResult.bHasVisual = true;
+	}
+
+	if (Input.bEvaluateCollision)
+	{
+		//everything below reads Input.Areas, the collision mesh is cut by its own list
+		Swap(Input.Areas, Input.CollisionAreas);
+		EvaluateMesh(Input.CollisionMesh, Input.CollisionSdf.Get(), Input.CollisionChunks.Get(),
+		             Input.CollisionIncremental.Get(), Input);
+		Swap(Input.Areas, Input.CollisionAreas);
+		OutResult.CollisionMesh = MoveTemp(Input.CollisionMesh);
+		OutResult.bHasCollision = true;
+	}
+
+	OutResult.OutputTriangleCount = (OutResult.bHasVisual ? OutResult.VisualMesh.TriangleCount() : 0) +
+		(OutResult.bHasCollision ? OutResult.CollisionMesh.TriangleCount() : 0);
+	OutResult.EvaluationSeconds = FPlatformTime::Seconds() - Start;
+}
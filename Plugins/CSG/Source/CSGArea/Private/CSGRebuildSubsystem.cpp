@@ -0,0 +1,333 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGRebuildSubsystem.h"
+
+#include "CSGMeshOperations.h"
+#include "CSGStats.h"
+#include "PluginSettings.h"
+#include "Async/ParallelFor.h"
+#include "Components/CSGBaseComponent.h"
+#include "Engine/LevelStreaming.h"
+#include "GameFramework/PlayerController.h"
+#include "UObject/UObjectIterator.h"
+
+namespace
+{
+	/// Logs the components of the world that spent the most time evaluating, CSG.DumpStats [Count].
+	/// This is the surface for the per component counters, stats would need a dynamic stat for every component
+	/// and stat CSG would list all of them instead of the ones worth looking at
+	FAutoConsoleCommandWithWorldAndArgs DumpStatsCommand(
+		TEXT("CSG.DumpStats"),
+		TEXT("Lists the CSG components that spent the most time evaluating. Optional argument: amount to list"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (!World)
+			{
+				return;
+			}
+
+			const int32 Count = Args.IsEmpty() ? 10 : FMath::Max(FCString::Atoi(*Args[0]), 1);
+
+			TArray<UCSGBaseComponent*> Components;
+			for (TObjectIterator<UCSGBaseComponent> It; It; ++It)
+			{
+				if (It->GetWorld() == World && It->HasBegunPlay())
+				{
+					Components.Add(*It);
+				}
+			}
+
+			Components.Sort([](const UCSGBaseComponent& A, const UCSGBaseComponent& B)
+			{
+				return A.GetRebuildStats().TotalEvaluationMs > B.GetRebuildStats().TotalEvaluationMs;
+			});
+
+			const UCSGRebuildSubsystem* Scheduler = World->GetSubsystem<UCSGRebuildSubsystem>();
+			UE_LOG(LogCSG, Display, TEXT("CSG: %d components, %d queued"), Components.Num(),
+			       Scheduler ? Scheduler->GetQueueLength() : 0);
+
+			for (int32 i = 0; i < FMath::Min(Count, Components.Num()); ++i)
+			{
+				const FCSGRebuildStats Stats = Components[i]->GetRebuildStats();
+				const FCSGScratchMeshStats Scratch = Components[i]->GetScratchMeshStats();
+				UE_LOG(LogCSG, Display,
+				       TEXT("  %s: %d rebuilds (%d/s), %.2f ms total, %.2f ms last, %.2f ms collision, ")
+				       TEXT("%d -> %d triangles, %d scratch meshes"),
+				       *Components[i]->GetReadableName(), Stats.RebuildCount, Stats.RebuildsPerSecond,
+				       Stats.TotalEvaluationMs, Stats.LastEvaluationMs, Stats.LastCollisionMs,
+				       Stats.InputTriangleCount, Stats.OutputTriangleCount, Scratch.MeshCount);
+			}
+		}));
+}
+
+void UCSGRebuildSubsystem::Enqueue(UCSGBaseComponent* Component)
+{
+	Waiting.Remove(Component);
+	Queue.FindOrAdd(Component, 0);
+}
+
+void UCSGRebuildSubsystem::EnqueueWhenDue(UCSGBaseComponent* Component)
+{
+	//a request that's already queued is processed anyway, the component parks itself again from there if needed
+	if (!Queue.Contains(Component))
+	{
+		Waiting.Add(Component);
+	}
+}
+
+void UCSGRebuildSubsystem::Dequeue(UCSGBaseComponent* Component)
+{
+	Queue.Remove(Component);
+	Waiting.Remove(Component);
+}
+
+void UCSGRebuildSubsystem::StoreStreamedState(const UCSGBaseComponent* Component, TArray<uint8>&& State)
+{
+	const FName Level = Component->GetOutermost()->GetFName();
+	StreamedStates.FindOrAdd(Level).Add(Component->GetPathName(), MoveTemp(State));
+}
+
+bool UCSGRebuildSubsystem::TakeStreamedState(const UCSGBaseComponent* Component, TArray<uint8>& OutState)
+{
+	const FName Level = Component->GetOutermost()->GetFName();
+	TMap<FString, TArray<uint8>>* States = StreamedStates.Find(Level);
+	if (!States || !States->RemoveAndCopyValue(Component->GetPathName(), OutState))
+	{
+		return false;
+	}
+
+	if (States->IsEmpty())
+	{
+		StreamedStates.Remove(Level);
+	}
+	return true;
+}
+
+void UCSGRebuildSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(
+		this, &UCSGRebuildSubsystem::OnLevelRemovedFromWorld);
+}
+
+void UCSGRebuildSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+	StreamedStates.Reset();
+
+	Super::Deinitialize();
+}
+
+void UCSGRebuildSubsystem::OnLevelRemovedFromWorld(ULevel* Level, UWorld* World)
+{
+	if (World != GetWorld())
+	{
+		return;
+	}
+
+	//no level means the whole world is going away
+	if (!Level)
+	{
+		StreamedStates.Reset();
+		return;
+	}
+
+	//a level that's only streamed out keeps its streaming level, the states of all others are purged here,
+	//including the ones of levels whose streaming level was removed since the last level went away
+	TSet<FName> StreamingPackages;
+	for (const ULevelStreaming* StreamingLevel : World->GetStreamingLevels())
+	{
+		if (StreamingLevel && !StreamingLevel->GetIsRequestingUnloadAndRemoval())
+		{
+			StreamingPackages.Add(StreamingLevel->GetWorldAssetPackageFName());
+		}
+	}
+
+	for (auto It = StreamedStates.CreateIterator(); It; ++It)
+	{
+		if (!StreamingPackages.Contains(It->Key))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+double UCSGRebuildSubsystem::GetEstimatedEvaluationSeconds(const UCSGBaseComponent* Component) const
+{
+	const FCSGRebuildStats Stats = Component->GetRebuildStats();
+	return Stats.RebuildCount > 0 ? Stats.LastEvaluationMs / 1000.0 : AverageEvaluationSeconds;
+}
+
+TStatId UCSGRebuildSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCSGRebuildSubsystem, STATGROUP_CSG);
+}
+
+double UCSGRebuildSubsystem::GetPriority(const UCSGBaseComponent* Component, int32 FramesWaiting,
+                                         const TArray<FVector>& Viewpoints) const
+{
+	const FVector Location = Component->Bounds.Origin;
+
+	double Distance = Viewpoints.IsEmpty() ? 0.0 : TNumericLimits<double>::Max();
+	for (const FVector& Viewpoint : Viewpoints)
+	{
+		Distance = FMath::Min(Distance, FVector::Distance(Viewpoint, Location));
+	}
+
+	//hidden components can wait, but not forever
+	if (!Component->WasCSGRecentlyRendered(0.2f))
+	{
+		Distance *= GetDefault<UPluginSettings>()->HiddenRebuildPriorityScale;
+	}
+
+	return Distance / (1.0 + FramesWaiting);
+}
+
+void UCSGRebuildSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGSchedule);
+
+	//parked components only get checked, they're fingerprinted once they're due
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (auto It = Waiting.CreateIterator(); It; ++It)
+	{
+		UCSGBaseComponent* Component = It->Get();
+		if (!Component)
+		{
+			It.RemoveCurrent();
+		}
+		else if (Component->IsRebuildDue(Now))
+		{
+			Queue.FindOrAdd(Component, 0);
+			It.RemoveCurrent();
+		}
+	}
+
+	SET_DWORD_STAT(STAT_CSGQueueLength, Queue.Num());
+
+	if (Queue.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<FVector> Viewpoints;
+	for (auto It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector Location;
+			FRotator Rotation;
+			PlayerController->GetPlayerViewPoint(Location, Rotation);
+			Viewpoints.Add(Location);
+		}
+	}
+
+	struct FEntry
+	{
+		UCSGBaseComponent* Component;
+		double Priority;
+	};
+
+	TArray<FEntry> Entries;
+	for (auto It = Queue.CreateIterator(); It; ++It)
+	{
+		UCSGBaseComponent* Component = It.Key().Get();
+		if (!Component)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		Entries.Add({Component, GetPriority(Component, It.Value(), Viewpoints)});
+	}
+
+	Entries.Sort([](const FEntry& A, const FEntry& B)
+	{
+		return A.Priority < B.Priority;
+	});
+
+	const UPluginSettings* Settings = GetDefault<UPluginSettings>();
+	const double Budget = (BudgetMsOverride >= 0.0f ? BudgetMsOverride : Settings->RebuildBudgetMs) / 1000.0;
+	const double Start = FPlatformTime::Seconds();
+
+	//one component per worker and one for the game thread, which joins in on the ParallelFor
+	const int32 BatchSize = Settings->bParallelRebuild ? FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 : 1;
+
+	bool bProcessedAny = false;
+	for (int32 Next = 0; Next < Entries.Num();)
+	{
+		TArray<UCSGBaseComponent*> Batch;
+		TArray<FCSGRebuildInput> Inputs;
+		double BatchEstimate = 0.0;
+		bool bOverBudget = false;
+
+		for (; Next < Entries.Num() && Batch.Num() < BatchSize; ++Next)
+		{
+			//components needing another pass queue or park themselves again, they'll be picked up next frame
+			//components ending play during this frame dequeue themselves
+			UCSGBaseComponent* Component = Entries[Next].Component;
+			if (!Queue.Contains(Component))
+			{
+				continue;
+			}
+
+			//the batch takes about as long as its slowest evaluation, at least one component is rebuilt every frame
+			//so the queue always drains, the others only start when they are expected to fit into the budget
+			const double Estimate = GetEstimatedEvaluationSeconds(Component);
+			if (Budget > 0.0 && bProcessedAny &&
+				FPlatformTime::Seconds() - Start + FMath::Max(BatchEstimate, Estimate) > Budget)
+			{
+				bOverBudget = true;
+				break;
+			}
+
+			Queue.Remove(Component);
+			bProcessedAny = true;
+
+			FCSGRebuildInput Input;
+			if (Component->BeginRebuild(Input))
+			{
+				Batch.Add(Component);
+				Inputs.Add(MoveTemp(Input));
+				BatchEstimate = FMath::Max(BatchEstimate, Estimate);
+
+				//nothing has been measured yet, the first evaluation runs on its own to get an estimate
+				if (Estimate < 0.0)
+				{
+					++Next;
+					break;
+				}
+			}
+		}
+
+		//the inputs are snapshots, so the evaluations don't touch the components or each other
+		TArray<FCSGRebuildResult> Results;
+		Results.SetNum(Inputs.Num());
+		ParallelFor(Inputs.Num(), [&Inputs, &Results](int32 Index)
+		{
+			CSG::Evaluate(Inputs[Index], Results[Index]);
+		});
+
+		for (int32 i = 0; i < Batch.Num(); ++i)
+		{
+			AverageEvaluationSeconds = AverageEvaluationSeconds < 0.0
+				                           ? Results[i].EvaluationSeconds
+				                           : FMath::Lerp(AverageEvaluationSeconds, Results[i].EvaluationSeconds, 0.1);
+			Batch[i]->ApplyRebuildResult(Results[i]);
+		}
+
+		if (bOverBudget)
+		{
+			for (; Next < Entries.Num(); ++Next)
+			{
+				if (int32* FramesWaiting = Queue.Find(Entries[Next].Component))
+				{
+					++*FramesWaiting;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,673 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGMeshOperations.h"
+
+#include "CSGStats.h"
+#include "Async/ParallelFor.h"
+#include "DynamicMesh/DynamicMeshAABBTree3.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "DynamicMesh/MeshNormals.h"
+#include "Spatial/FastWinding.h"
+
+using namespace UE::Geometry;
+
+/// @brief Sparse bricked signed distance field of a source mesh, along with the areas applied to it
+/// and the meshed surface of every brick
+struct FCSGSdfCache
+{
+	/// @brief Points per brick along each axis
+	static constexpr int32 BrickSize = 8;
+	static constexpr int32 BrickPoints = BrickSize * BrickSize * BrickSize;
+
+	/// @brief The voxel size is raised until the field fits this many points along its longest axis
+	static constexpr int32 MaxPointsPerAxis = 512;
+
+	/// @brief What the distances of a brick are with the areas applied
+	enum class ECurrent : uint8
+	{
+		/// @brief No area touches the brick
+		Base,
+		/// @brief Current holds the distances
+		Samples,
+		/// @brief The whole brick is outside, when intersecting with areas that don't reach it
+		Outside
+	};
+
+	struct FBrick
+	{
+		/// @brief Distances to the source mesh, empty when the whole brick is BaseUniform
+		TArray<float> Base;
+		float BaseUniform = 0.0f;
+
+		ECurrent CurrentMode = ECurrent::Base;
+		TArray<float> Current;
+
+		/// @brief Surface of the cells starting in this brick, as edge keys shared with the neighbouring bricks
+		TArray<uint64> TriangleEdges;
+		TArray<int32> TriangleMaterials;
+		TMap<uint64, FVector3d> Vertices;
+	};
+
+	explicit FCSGSdfCache(float InVoxelSize)
+		: VoxelSize(InVoxelSize)
+	{
+	}
+
+	double VoxelSize;
+	bool bBuilt = false;
+
+	FVector3d Origin = FVector3d::Zero();
+	FIntVector BrickCount = FIntVector::ZeroValue;
+	float MaxDistance = 0.0f;
+	TArray<FBrick> Bricks;
+
+	/// @brief Kept to find the material of the faces that are still on the source surface
+	FDynamicMesh3 Source;
+	TUniquePtr<FDynamicMeshAABBTree3> SourceTree;
+
+	TArray<FCSGAreaSnapshot> AppliedAreas;
+	FTransform ComponentTransform;
+	bool bAppliedReverse = false;
+
+	FIntVector GetPointCount() const
+	{
+		return BrickCount * BrickSize;
+	}
+
+	int32 GetBrickIndex(const FIntVector& Brick) const
+	{
+		return Brick.X + (Brick.Y + Brick.Z * BrickCount.Y) * BrickCount.X;
+	}
+
+	FIntVector GetBrick(int32 Index) const
+	{
+		return FIntVector(Index % BrickCount.X, (Index / BrickCount.X) % BrickCount.Y,
+		                  Index / (BrickCount.X * BrickCount.Y));
+	}
+
+	static int32 GetLocalIndex(int32 X, int32 Y, int32 Z)
+	{
+		return X + (Y + Z * BrickSize) * BrickSize;
+	}
+
+	FVector3d GetPointPosition(const FIntVector& Point) const
+	{
+		return Origin + FVector3d(Point.X, Point.Y, Point.Z) * VoxelSize;
+	}
+
+	/// @brief Distance at a grid point with the areas applied, points outside the field are outside the mesh
+	float GetSample(const FIntVector& Point) const
+	{
+		const FIntVector PointCount = GetPointCount();
+		if (Point.X < 0 || Point.Y < 0 || Point.Z < 0 ||
+			Point.X >= PointCount.X || Point.Y >= PointCount.Y || Point.Z >= PointCount.Z)
+		{
+			return MaxDistance;
+		}
+
+		const FIntVector Brick(Point.X / BrickSize, Point.Y / BrickSize, Point.Z / BrickSize);
+		const FBrick& Data = Bricks[GetBrickIndex(Brick)];
+		const int32 Local = GetLocalIndex(Point.X - Brick.X * BrickSize, Point.Y - Brick.Y * BrickSize,
+		                                  Point.Z - Brick.Z * BrickSize);
+
+		float Value;
+		switch (Data.CurrentMode)
+		{
+		case ECurrent::Samples:
+			Value = Data.Current[Local];
+			break;
+		case ECurrent::Outside:
+			Value = MaxDistance;
+			break;
+		default:
+			Value = Data.Base.IsEmpty() ? Data.BaseUniform : Data.Base[Local];
+			break;
+		}
+
+		//exact zeros would put several surface vertices on the same point
+		return FMath::Abs(Value) < UE_KINDA_SMALL_NUMBER ? UE_KINDA_SMALL_NUMBER : Value;
+	}
+
+	FAxisAlignedBox3d GetBrickBounds(const FIntVector& Brick) const
+	{
+		//the cells of a brick reach the first points of the next one
+		const FVector3d Min = GetPointPosition(Brick * BrickSize);
+		return FAxisAlignedBox3d(Min, Min + FVector3d(BrickSize * VoxelSize));
+	}
+};
+
+namespace
+{
+	/// @brief Area prepared for evaluating its distance at points in the local space of the component
+	struct FSdfCutter
+	{
+		const FCSGAreaSnapshot* Area = nullptr;
+		FAxisAlignedBox3d LocalBounds;
+
+		/// @brief Converts distances in the space of the area to the space of the component
+		double Scale = 1.0;
+
+		TUniquePtr<FDynamicMeshAABBTree3> Tree;
+		TUniquePtr<TFastWindingTree<FDynamicMesh3>> Winding;
+	};
+
+	FAxisAlignedBox3d GetLocalAreaBounds(const FCSGAreaSnapshot& Area, const FTransform& ComponentTransform)
+	{
+		const FVector3d Center = ComponentTransform.InverseTransformPosition(Area.Transform.GetLocation());
+		const double Radius = Area.Radius * Area.Transform.GetScale3D().GetAbsMax() /
+			FMath::Max(ComponentTransform.GetScale3D().GetAbsMin(), UE_DOUBLE_KINDA_SMALL_NUMBER);
+		return FAxisAlignedBox3d(Center - FVector3d(Radius), Center + FVector3d(Radius));
+	}
+
+	void PrepareCutter(FSdfCutter& Cutter, const FCSGAreaSnapshot& Area, const FTransform& ComponentTransform)
+	{
+		Cutter.Area = &Area;
+		Cutter.LocalBounds = GetLocalAreaBounds(Area, ComponentTransform);
+		Cutter.Scale = Area.Transform.GetScale3D().GetAbsMin() /
+			FMath::Max(ComponentTransform.GetScale3D().GetAbsMax(), UE_DOUBLE_KINDA_SMALL_NUMBER);
+
+		//the analytic shapes don't need their mesh
+		const bool bNeedsMesh = Area.Shape == ECSGAreaShape::Convex || Area.Shape == ECSGAreaShape::StaticMesh;
+		if (bNeedsMesh && Area.Cutter)
+		{
+			Cutter.Tree = MakeUnique<FDynamicMeshAABBTree3>(Area.Cutter.Get(), true);
+			Cutter.Winding = MakeUnique<TFastWindingTree<FDynamicMesh3>>(Cutter.Tree.Get(), true);
+		}
+	}
+
+	/// @brief Signed distance to the shape of the area, negative inside, in the local space of the component
+	double GetCutterDistance(const FSdfCutter& Cutter, const FVector3d& LocalPoint, const FTransform& ComponentTransform)
+	{
+		const FCSGAreaSnapshot& Area = *Cutter.Area;
+		const FVector3d Point = Area.Transform.InverseTransformPosition(ComponentTransform.TransformPosition(LocalPoint));
+
+		double Distance;
+		if (Cutter.Winding)
+		{
+			double DistanceSqr;
+			Cutter.Tree->FindNearestTriangle(Point, DistanceSqr);
+			Distance = FMath::Sqrt(DistanceSqr) * (Cutter.Winding->IsInside(Point) ? -1.0 : 1.0);
+		}
+		else
+		{
+			switch (Area.Shape)
+			{
+			case ECSGAreaShape::Box:
+				{
+					const FVector3d Q = Point.GetAbs() - FVector3d(Area.Extent);
+					Distance = Q.ComponentMax(FVector3d::Zero()).Length() + FMath::Min(Q.GetMax(), 0.0);
+					break;
+				}
+			case ECSGAreaShape::Capsule:
+				{
+					const double HalfLength = FMath::Max(Area.Extent.Z - Area.Extent.X, 0.0);
+					const double Z = FMath::Clamp(Point.Z, -HalfLength, HalfLength);
+					Distance = (Point - FVector3d(0.0, 0.0, Z)).Length() - Area.Extent.X;
+					break;
+				}
+			default:
+				Distance = Point.Length() - Area.Radius;
+				break;
+			}
+		}
+
+		return Distance * Cutter.Scale;
+	}
+
+	void BuildField(FCSGSdfCache& Cache, FDynamicMesh3&& Mesh)
+	{
+		Cache.bBuilt = true;
+		Cache.Source = MoveTemp(Mesh);
+		if (Cache.Source.TriangleCount() == 0)
+		{
+			return;
+		}
+
+		Cache.SourceTree = MakeUnique<FDynamicMeshAABBTree3>(&Cache.Source, true);
+		const TFastWindingTree<FDynamicMesh3> Winding(Cache.SourceTree.Get(), true);
+
+		//two points of padding around the mesh, so the surface is always closed by points outside of it
+		const FAxisAlignedBox3d Bounds = Cache.Source.GetBounds(true);
+		Cache.VoxelSize = FMath::Max3(Cache.VoxelSize, UE_DOUBLE_KINDA_SMALL_NUMBER,
+		                              Bounds.MaxDim() / (FCSGSdfCache::MaxPointsPerAxis - 4));
+		Cache.Origin = Bounds.Min - FVector3d(2.0 * Cache.VoxelSize);
+
+		const FVector3d Size = Bounds.Diagonal() / Cache.VoxelSize;
+		const FIntVector PointCount(FMath::CeilToInt32(Size.X) + 5, FMath::CeilToInt32(Size.Y) + 5,
+		                            FMath::CeilToInt32(Size.Z) + 5);
+		Cache.BrickCount = FIntVector(FMath::DivideAndRoundUp(PointCount.X, FCSGSdfCache::BrickSize),
+		                              FMath::DivideAndRoundUp(PointCount.Y, FCSGSdfCache::BrickSize),
+		                              FMath::DivideAndRoundUp(PointCount.Z, FCSGSdfCache::BrickSize));
+
+		//distances further away than a brick never decide where the surface goes
+		Cache.MaxDistance = static_cast<float>(FCSGSdfCache::BrickSize * Cache.VoxelSize);
+		Cache.Bricks.SetNum(Cache.BrickCount.X * Cache.BrickCount.Y * Cache.BrickCount.Z);
+
+		const double HalfDiagonal = 0.5 * FMath::Sqrt(3.0) * FCSGSdfCache::BrickSize * Cache.VoxelSize;
+		ParallelFor(Cache.Bricks.Num(), [&Cache, &Winding, HalfDiagonal](int32 Index)
+		{
+			const FIntVector Brick = Cache.GetBrick(Index);
+			FCSGSdfCache::FBrick& Data = Cache.Bricks[Index];
+
+			//bricks away from the surface are entirely inside or outside, a single value is enough
+			const FVector3d Center = Cache.GetBrickBounds(Brick).Center();
+			double DistanceSqr;
+			Cache.SourceTree->FindNearestTriangle(Center, DistanceSqr);
+			if (FMath::Sqrt(DistanceSqr) > HalfDiagonal + Cache.VoxelSize)
+			{
+				Data.BaseUniform = Winding.IsInside(Center) ? -Cache.MaxDistance : Cache.MaxDistance;
+				return;
+			}
+
+			Data.Base.SetNumUninitialized(FCSGSdfCache::BrickPoints);
+			for (int32 Z = 0; Z < FCSGSdfCache::BrickSize; ++Z)
+			{
+				for (int32 Y = 0; Y < FCSGSdfCache::BrickSize; ++Y)
+				{
+					for (int32 X = 0; X < FCSGSdfCache::BrickSize; ++X)
+					{
+						const FVector3d Point = Cache.GetPointPosition(Brick * FCSGSdfCache::BrickSize +
+							FIntVector(X, Y, Z));
+						Cache.SourceTree->FindNearestTriangle(Point, DistanceSqr);
+						const double Distance = FMath::Min(FMath::Sqrt(DistanceSqr),
+						                                   static_cast<double>(Cache.MaxDistance));
+						Data.Base[FCSGSdfCache::GetLocalIndex(X, Y, Z)] =
+							static_cast<float>(Winding.IsInside(Point) ? -Distance : Distance);
+					}
+				}
+			}
+		});
+	}
+
+	/// @brief Applies the cutters touching the brick to its source distances
+	void EvaluateBrick(FCSGSdfCache& Cache, int32 Index, const TArray<FSdfCutter>& Cutters,
+	                   const FCSGRebuildInput& Input)
+	{
+		const FIntVector Brick = Cache.GetBrick(Index);
+		FCSGSdfCache::FBrick& Data = Cache.Bricks[Index];
+		const FAxisAlignedBox3d Bounds = Cache.GetBrickBounds(Brick);
+
+		TArray<const FSdfCutter*, TInlineAllocator<8>> Touching;
+		for (const FSdfCutter& Cutter : Cutters)
+		{
+			if (Cutter.LocalBounds.Intersects(Bounds))
+			{
+				Touching.Add(&Cutter);
+			}
+		}
+
+		if (Touching.IsEmpty())
+		{
+			//subtracting nothing keeps the source, intersecting with nothing keeps nothing
+			Data.CurrentMode = Input.bReverse ? FCSGSdfCache::ECurrent::Base : FCSGSdfCache::ECurrent::Outside;
+			Data.Current.Empty();
+			return;
+		}
+
+		Data.CurrentMode = FCSGSdfCache::ECurrent::Samples;
+		Data.Current.SetNumUninitialized(FCSGSdfCache::BrickPoints);
+		for (int32 Z = 0; Z < FCSGSdfCache::BrickSize; ++Z)
+		{
+			for (int32 Y = 0; Y < FCSGSdfCache::BrickSize; ++Y)
+			{
+				for (int32 X = 0; X < FCSGSdfCache::BrickSize; ++X)
+				{
+					const int32 Local = FCSGSdfCache::GetLocalIndex(X, Y, Z);
+					const FVector3d Point = Cache.GetPointPosition(Brick * FCSGSdfCache::BrickSize +
+						FIntVector(X, Y, Z));
+
+					//the union of the areas is the minimum of their distances
+					double Areas = TNumericLimits<double>::Max();
+					for (const FSdfCutter* Cutter : Touching)
+					{
+						Areas = FMath::Min(Areas, GetCutterDistance(*Cutter, Point, Input.ComponentTransform));
+					}
+
+					const double Source = Data.Base.IsEmpty() ? Data.BaseUniform : Data.Base[Local];
+					const double Value = Input.bReverse ? FMath::Max(Source, -Areas) : FMath::Max(Source, Areas);
+					Data.Current[Local] = static_cast<float>(FMath::Clamp<double>(Value, -Cache.MaxDistance,
+						Cache.MaxDistance));
+				}
+			}
+		}
+	}
+
+	/// @brief Identifies the edge between a grid point and the point at the 0/1 offset, the same for every brick
+	uint64 MakeEdgeKey(const FCSGSdfCache& Cache, const FIntVector& Point, int32 OffsetBits)
+	{
+		const FIntVector PointCount = Cache.GetPointCount();
+		const uint64 PointIndex = Point.X + (static_cast<uint64>(Point.Y) + static_cast<uint64>(Point.Z) * PointCount.Y)
+			* PointCount.X;
+		return PointIndex << 3 | OffsetBits;
+	}
+
+	FIntVector GetCornerOffset(int32 Corner)
+	{
+		return FIntVector(Corner & 1, Corner >> 1 & 1, Corner >> 2 & 1);
+	}
+
+	/// Material of a face, the cut faces are the ones away from the source surface and get the material of the area
+	/// whose surface is the closest
+	int32 GetFaceMaterial(const FCSGSdfCache& Cache, const FVector3d& Centroid, const TArray<FSdfCutter>& Cutters,
+	                      const FCSGRebuildInput& Input)
+	{
+		double DistanceSqr;
+		const int32 Triangle = Cache.SourceTree->FindNearestTriangle(Centroid, DistanceSqr);
+		if (Triangle == IndexConstants::InvalidID || DistanceSqr > FMath::Square(0.5 * Cache.VoxelSize))
+		{
+			int32 MaterialID = Input.CSGMaterialID;
+			double Nearest = TNumericLimits<double>::Max();
+			for (const FSdfCutter& Cutter : Cutters)
+			{
+				//the face is at most a voxel away from the surface of the area that made it
+				if (Cutter.LocalBounds.Distance(Centroid) > Cache.VoxelSize)
+				{
+					continue;
+				}
+
+				const double Distance = FMath::Abs(GetCutterDistance(Cutter, Centroid, Input.ComponentTransform));
+				if (Distance < Nearest)
+				{
+					Nearest = Distance;
+					MaterialID = Cutter.Area->MaterialID;
+				}
+			}
+			return MaterialID;
+		}
+
+		const FDynamicMeshMaterialAttribute* Materials = Cache.Source.HasAttributes()
+			                                                 ? Cache.Source.Attributes()->GetMaterialID()
+			                                                 : nullptr;
+		return Materials ? Materials->GetValue(Triangle) : 0;
+	}
+
+	/// Meshes the cells starting in the brick with marching tetrahedra, every cube is split into the six tetrahedra
+	/// around its diagonal, so all edges run from a point to one with equal or higher coordinates
+	void MeshBrick(FCSGSdfCache& Cache, int32 Index, const TArray<FSdfCutter>& Cutters, const FCSGRebuildInput& Input)
+	{
+		static constexpr int32 Tetrahedra[6][4] = {
+			{0, 1, 3, 7}, {0, 1, 5, 7}, {0, 2, 3, 7}, {0, 2, 6, 7}, {0, 4, 5, 7}, {0, 4, 6, 7}
+		};
+
+		const FIntVector Brick = Cache.GetBrick(Index);
+		FCSGSdfCache::FBrick& Data = Cache.Bricks[Index];
+		Data.TriangleEdges.Reset();
+		Data.TriangleMaterials.Reset();
+		Data.Vertices.Reset();
+
+		const FIntVector First = Brick * FCSGSdfCache::BrickSize;
+		const FIntVector PointCount = Cache.GetPointCount();
+
+		for (int32 Z = 0; Z < FCSGSdfCache::BrickSize; ++Z)
+		{
+			for (int32 Y = 0; Y < FCSGSdfCache::BrickSize; ++Y)
+			{
+				for (int32 X = 0; X < FCSGSdfCache::BrickSize; ++X)
+				{
+					const FIntVector Cell = First + FIntVector(X, Y, Z);
+					if (Cell.X + 1 >= PointCount.X || Cell.Y + 1 >= PointCount.Y || Cell.Z + 1 >= PointCount.Z)
+					{
+						continue;
+					}
+
+					float Values[8];
+					bool bAnyInside = false;
+					bool bAnyOutside = false;
+					for (int32 Corner = 0; Corner < 8; ++Corner)
+					{
+						Values[Corner] = Cache.GetSample(Cell + GetCornerOffset(Corner));
+						bAnyInside |= Values[Corner] < 0.0f;
+						bAnyOutside |= Values[Corner] >= 0.0f;
+					}
+					if (!bAnyInside || !bAnyOutside)
+					{
+						continue;
+					}
+
+					auto EdgeVertex = [&](int32 A, int32 B)
+					{
+						//corners of the same tetrahedron are ordered by their offset bits
+						if ((A & B) != A)
+						{
+							Swap(A, B);
+						}
+						const uint64 Key = MakeEdgeKey(Cache, Cell + GetCornerOffset(A), A ^ B);
+						if (!Data.Vertices.Contains(Key))
+						{
+							const FVector3d PointA = Cache.GetPointPosition(Cell + GetCornerOffset(A));
+							const FVector3d PointB = Cache.GetPointPosition(Cell + GetCornerOffset(B));
+							const double T = Values[A] / (Values[A] - Values[B]);
+							Data.Vertices.Add(Key, PointA + (PointB - PointA) * T);
+						}
+						return Key;
+					};
+
+					auto AddTriangle = [&](uint64 A, uint64 B, uint64 C, const FVector3d& Outward)
+					{
+						const FVector3d& PA = Data.Vertices[A];
+						const FVector3d& PB = Data.Vertices[B];
+						const FVector3d& PC = Data.Vertices[C];
+						const FVector3d Normal = (PB - PA).Cross(PC - PA);
+						if (Normal.SquaredLength() < UE_DOUBLE_SMALL_NUMBER)
+						{
+							return;
+						}
+						if (Normal.Dot(Outward) < 0.0)
+						{
+							Swap(B, C);
+						}
+						Data.TriangleEdges.Append({A, B, C});
+						Data.TriangleMaterials.Add(GetFaceMaterial(Cache, (PA + PB + PC) / 3.0, Cutters, Input));
+					};
+
+					for (const int32(&Tetrahedron)[4] : Tetrahedra)
+					{
+						TArray<int32, TInlineAllocator<4>> Inside;
+						TArray<int32, TInlineAllocator<4>> Outside;
+						FVector3d InsideCenter = FVector3d::Zero();
+						FVector3d OutsideCenter = FVector3d::Zero();
+						for (const int32 Corner : Tetrahedron)
+						{
+							const FVector3d Position = Cache.GetPointPosition(Cell + GetCornerOffset(Corner));
+							if (Values[Corner] < 0.0f)
+							{
+								Inside.Add(Corner);
+								InsideCenter += Position;
+							}
+							else
+							{
+								Outside.Add(Corner);
+								OutsideCenter += Position;
+							}
+						}
+						if (Inside.IsEmpty() || Outside.IsEmpty())
+						{
+							continue;
+						}
+
+						//faces point away from the inside of the tetrahedron
+						const FVector3d Outward = OutsideCenter / Outside.Num() - InsideCenter / Inside.Num();
+
+						if (Inside.Num() == 2)
+						{
+							const uint64 A = EdgeVertex(Inside[0], Outside[0]);
+							const uint64 B = EdgeVertex(Inside[0], Outside[1]);
+							const uint64 C = EdgeVertex(Inside[1], Outside[1]);
+							const uint64 D = EdgeVertex(Inside[1], Outside[0]);
+							AddTriangle(A, B, C, Outward);
+							AddTriangle(A, C, D, Outward);
+						}
+						else
+						{
+							const TArray<int32, TInlineAllocator<4>>& Single = Inside.Num() == 1 ? Inside : Outside;
+							const TArray<int32, TInlineAllocator<4>>& Others = Inside.Num() == 1 ? Outside : Inside;
+							AddTriangle(EdgeVertex(Single[0], Others[0]), EdgeVertex(Single[0], Others[1]),
+							            EdgeVertex(Single[0], Others[2]), Outward);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/// @brief Indices of the bricks whose bounds intersect the box
+	void CollectBricks(const FCSGSdfCache& Cache, const FAxisAlignedBox3d& Bounds, TSet<int32>& OutBricks)
+	{
+		const double BrickExtent = FCSGSdfCache::BrickSize * Cache.VoxelSize;
+		const FVector3d Min = (Bounds.Min - Cache.Origin) / BrickExtent;
+		const FVector3d Max = (Bounds.Max - Cache.Origin) / BrickExtent;
+		const FIntVector First(FMath::Max(FMath::FloorToInt32(Min.X), 0), FMath::Max(FMath::FloorToInt32(Min.Y), 0),
+		                       FMath::Max(FMath::FloorToInt32(Min.Z), 0));
+		const FIntVector Last(FMath::Min(FMath::FloorToInt32(Max.X), Cache.BrickCount.X - 1),
+		                      FMath::Min(FMath::FloorToInt32(Max.Y), Cache.BrickCount.Y - 1),
+		                      FMath::Min(FMath::FloorToInt32(Max.Z), Cache.BrickCount.Z - 1));
+
+		for (int32 Z = First.Z; Z <= Last.Z; ++Z)
+		{
+			for (int32 Y = First.Y; Y <= Last.Y; ++Y)
+			{
+				for (int32 X = First.X; X <= Last.X; ++X)
+				{
+					OutBricks.Add(Cache.GetBrickIndex(FIntVector(X, Y, Z)));
+				}
+			}
+		}
+	}
+
+	/// @brief Bricks whose distances have to be evaluated again, because an area touching them changed
+	void CollectChangedBricks(const FCSGSdfCache& Cache, const FCSGRebuildInput& Input, bool bFirstBuild,
+	                          TSet<int32>& OutBricks)
+	{
+		//the areas are placed relative to the component, moving it moves all of them
+		if (bFirstBuild || Cache.bAppliedReverse != Input.bReverse ||
+			!Cache.ComponentTransform.Equals(Input.ComponentTransform))
+		{
+			for (int32 Index = 0; Index < Cache.Bricks.Num(); ++Index)
+			{
+				OutBricks.Add(Index);
+			}
+			return;
+		}
+
+		//areas in the same state in both lists don't change any brick
+		auto Collect = [&Cache, &OutBricks](const TArray<FCSGAreaSnapshot>& Areas, const TArray<FCSGAreaSnapshot>& Others,
+		                                    const FTransform& Transform)
+		{
+			for (const FCSGAreaSnapshot& Area : Areas)
+			{
+				const FCSGAreaSnapshot* Other = Others.FindByPredicate([&Area](const FCSGAreaSnapshot& Candidate)
+				{
+					return Candidate.Component == Area.Component;
+				});
+				if (!Other || !Other->Equals(Area))
+				{
+					CollectBricks(Cache, GetLocalAreaBounds(Area, Transform), OutBricks);
+				}
+			}
+		};
+		Collect(Input.Areas, Cache.AppliedAreas, Input.ComponentTransform);
+		Collect(Cache.AppliedAreas, Input.Areas, Cache.ComponentTransform);
+	}
+}
+
+TSharedPtr<FCSGSdfCache, ESPMode::ThreadSafe> CSG::MakeSdfCache(float VoxelSize)
+{
+	return MakeShared<FCSGSdfCache, ESPMode::ThreadSafe>(VoxelSize);
+}
+
+bool CSG::IsSdfBuilt(const FCSGSdfCache& Cache)
+{
+	return Cache.bBuilt;
+}
+
+void CSG::EvaluateSdf(FDynamicMesh3& Mesh, FCSGSdfCache& Cache, const FCSGRebuildInput& Input)
+{
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGEvaluateSdf);
+
+	const bool bFirstBuild = !Cache.bBuilt;
+	if (bFirstBuild)
+	{
+		BuildField(Cache, MoveTemp(Mesh));
+	}
+
+	Mesh = FDynamicMesh3();
+	Mesh.EnableAttributes();
+	Mesh.Attributes()->EnableMaterialID();
+	if (Cache.Bricks.IsEmpty())
+	{
+		return;
+	}
+
+	TSet<int32> Changed;
+	CollectChangedBricks(Cache, Input, bFirstBuild, Changed);
+
+	TArray<FSdfCutter> Cutters;
+	Cutters.SetNum(Input.Areas.Num());
+	for (int32 i = 0; i < Input.Areas.Num(); ++i)
+	{
+		PrepareCutter(Cutters[i], Input.Areas[i], Input.ComponentTransform);
+	}
+
+	const TArray<int32> ChangedBricks = Changed.Array();
+	ParallelFor(ChangedBricks.Num(), [&Cache, &ChangedBricks, &Cutters, &Input](int32 i)
+	{
+		EvaluateBrick(Cache, ChangedBricks[i], Cutters, Input);
+	});
+
+	//cells read the first points of the bricks after them, so the bricks before a changed one change as well
+	TSet<int32> Remesh;
+	for (const int32 Index : ChangedBricks)
+	{
+		const FIntVector Brick = Cache.GetBrick(Index);
+		for (int32 Corner = 0; Corner < 8; ++Corner)
+		{
+			const FIntVector Neighbour = Brick - GetCornerOffset(Corner);
+			if (Neighbour.X >= 0 && Neighbour.Y >= 0 && Neighbour.Z >= 0)
+			{
+				Remesh.Add(Cache.GetBrickIndex(Neighbour));
+			}
+		}
+	}
+
+	const TArray<int32> RemeshBricks = Remesh.Array();
+	ParallelFor(RemeshBricks.Num(), [&Cache, &RemeshBricks, &Cutters, &Input](int32 i)
+	{
+		MeshBrick(Cache, RemeshBricks[i], Cutters, Input);
+	});
+
+	Cache.AppliedAreas = Input.Areas;
+	Cache.ComponentTransform = Input.ComponentTransform;
+	Cache.bAppliedReverse = Input.bReverse;
+
+	//vertices on the faces between bricks are shared through their edge keys
+	FDynamicMeshMaterialAttribute* Materials = Mesh.Attributes()->GetMaterialID();
+	TMap<uint64, int32> VertexIDs;
+	for (const FCSGSdfCache::FBrick& Data : Cache.Bricks)
+	{
+		for (int32 Triangle = 0; Triangle < Data.TriangleMaterials.Num(); ++Triangle)
+		{
+			FIndex3i Vertices;
+			for (int32 Corner = 0; Corner < 3; ++Corner)
+			{
+				const uint64 Key = Data.TriangleEdges[Triangle * 3 + Corner];
+				if (const int32* Found = VertexIDs.Find(Key))
+				{
+					Vertices[Corner] = *Found;
+				}
+				else
+				{
+					Vertices[Corner] = VertexIDs.Add(Key, Mesh.AppendVertex(Data.Vertices[Key]));
+				}
+			}
+
+			const int32 TriangleID = Mesh.AppendTriangle(Vertices);
+			if (TriangleID >= 0)
+			{
+				Materials->SetValue(TriangleID, Data.TriangleMaterials[Triangle]);
+			}
+		}
+	}
+
+	FMeshNormals::InitializeOverlayToPerVertexNormals(Mesh.Attributes()->PrimaryNormals(), false);
+}
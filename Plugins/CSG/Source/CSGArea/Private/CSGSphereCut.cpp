@@ -0,0 +1,473 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGMeshOperations.h"
+
+#include "CSGStats.h"
+#include "DynamicMeshEditor.h"
+#include "Algo/AllOf.h"
+#include "MeshBoundaryLoops.h"
+#include "Distance/DistPoint3Triangle3.h"
+#include "DynamicMesh/DynamicMeshAABBTree3.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "Spatial/FastWinding.h"
+
+using namespace UE::Geometry;
+
+namespace
+{
+	/// @brief Angle between two rings of the cap, keeps the cap smooth regardless of the size of the cut
+	constexpr double CapStepAngle = FMathd::Pi / 18.0;
+
+	/// @brief Caps spanning more than this are left to the mesh boolean, the ring interpolation becomes unstable
+	constexpr double MaxCapAngle = FMathd::Pi * 5.0 / 6.0;
+
+	enum class ESide : uint8
+	{
+		Inside,
+		Surface,
+		Outside
+	};
+
+	struct FSphere
+	{
+		FVector3d Center;
+		double Radius;
+		double Tolerance;
+
+		ESide Classify(const FVector3d& Point) const
+		{
+			const double Distance = FVector3d::Distance(Point, Center) - Radius;
+			if (Distance < -Tolerance)
+			{
+				return ESide::Inside;
+			}
+			return Distance > Tolerance ? ESide::Outside : ESide::Surface;
+		}
+
+		FVector3d Project(const FVector3d& Direction) const
+		{
+			return Center + Normalized(Direction) * Radius;
+		}
+	};
+
+	/// @brief Finds where the segment crosses the sphere, ignoring crossings at the end points
+	bool FindCrossing(const FSphere& Sphere, const FVector3d& A, const FVector3d& B, double& OutT)
+	{
+		const FVector3d D = B - A;
+		const FVector3d F = A - Sphere.Center;
+
+		const double QA = D.SquaredLength();
+		const double QB = 2.0 * F.Dot(D);
+		const double QC = F.SquaredLength() - Sphere.Radius * Sphere.Radius;
+
+		const double Discriminant = QB * QB - 4.0 * QA * QC;
+		if (QA < FMathd::ZeroTolerance || Discriminant <= 0.0)
+		{
+			return false;
+		}
+
+		const double Length = FMath::Sqrt(QA);
+		const double MinT = Sphere.Tolerance / Length;
+		const double Root = FMath::Sqrt(Discriminant);
+
+		for (const double T : {(-QB - Root) / (2.0 * QA), (-QB + Root) / (2.0 * QA)})
+		{
+			if (T > MinT && T < 1.0 - MinT)
+			{
+				OutT = T;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/// @brief Splits every edge crossing the sphere, so no triangle has vertices on both sides afterward
+	bool SplitCrossingEdges(FDynamicMesh3& Mesh, const FSphere& Sphere)
+	{
+		TArray<int32> Queue;
+		for (const int32 Edge : Mesh.EdgeIndicesItr())
+		{
+			Queue.Add(Edge);
+		}
+
+		//every split puts a vertex on the sphere, so this only runs out on degenerate input
+		int32 Budget = Mesh.EdgeCount() * 4;
+
+		while (!Queue.IsEmpty())
+		{
+			const int32 Edge = Queue.Pop();
+			if (!Mesh.IsEdge(Edge))
+			{
+				continue;
+			}
+
+			const FIndex2i Vertices = Mesh.GetEdgeV(Edge);
+			double T;
+			if (!FindCrossing(Sphere, Mesh.GetVertex(Vertices.A), Mesh.GetVertex(Vertices.B), T))
+			{
+				continue;
+			}
+
+			if (--Budget < 0)
+			{
+				return false;
+			}
+
+			FDynamicMesh3::FEdgeSplitInfo SplitInfo;
+			if (Mesh.SplitEdge(Edge, SplitInfo, T) != EMeshResult::Ok)
+			{
+				return false;
+			}
+
+			//the new edges start on the sphere, but can still cross it again further along
+			Queue.Add(Edge);
+			Queue.Add(SplitInfo.NewEdges.A);
+			Queue.Add(SplitInfo.NewEdges.B);
+			if (SplitInfo.NewEdges.C != IndexConstants::InvalidID)
+			{
+				Queue.Add(SplitInfo.NewEdges.C);
+			}
+		}
+
+		return true;
+	}
+
+	/// @brief Classifies a triangle after splitting, returns false when it still straddles the sphere
+	bool ClassifyTriangle(const FDynamicMesh3& Mesh, const FSphere& Sphere, int32 Triangle, ESide& OutSide)
+	{
+		FVector3d A, B, C;
+		Mesh.GetTriVertices(Triangle, A, B, C);
+
+		bool bInside = false;
+		bool bOutside = false;
+		ESide Sides[3];
+		for (int32 i = 0; i < 3; ++i)
+		{
+			Sides[i] = Sphere.Classify(i == 0 ? A : i == 1 ? B : C);
+			bInside |= Sides[i] == ESide::Inside;
+			bOutside |= Sides[i] == ESide::Outside;
+		}
+
+		if (bInside && bOutside)
+		{
+			return false;
+		}
+
+		if (bInside)
+		{
+			OutSide = ESide::Inside;
+			return true;
+		}
+
+		//the sphere can poke through the face without crossing any of its edges
+		FDistPoint3Triangle3d Distance(Sphere.Center, FTriangle3d(A, B, C));
+		const double Limit = Sphere.Radius - Sphere.Tolerance;
+		if (bOutside && Distance.GetSquared() < Limit * Limit)
+		{
+			//an edge between two vertices on the sphere is a chord dipping below it, the cap shares that chord,
+			//so the face only pokes through when its closest point lies off the vertices on the sphere
+			constexpr double OffSurfaceWeight = 1e-6;
+			for (int32 i = 0; i < 3; ++i)
+			{
+				if (Sides[i] == ESide::Outside && Distance.TriangleBaryCoords[i] > OffSurfaceWeight)
+				{
+					return false;
+				}
+			}
+		}
+
+		OutSide = bOutside ? ESide::Outside : Sphere.Classify(Mesh.GetTriCentroid(Triangle));
+		if (OutSide == ESide::Surface)
+		{
+			OutSide = ESide::Inside;
+		}
+		return true;
+	}
+
+	FVector3d SlerpDirection(const FVector3d& From, const FVector3d& To, double Alpha)
+	{
+		const double Angle = AngleR(From, To);
+		if (Angle < FMathd::ZeroTolerance)
+		{
+			return From;
+		}
+
+		const double Sin = FMath::Sin(Angle);
+		return From * (FMath::Sin((1.0 - Alpha) * Angle) / Sin) + To * (FMath::Sin(Alpha * Angle) / Sin);
+	}
+
+	/// @brief Closes a boundary loop lying on the sphere with rings of vertices on the sphere surface
+	bool AppendCap(FDynamicMesh3& Mesh, const FSphere& Sphere, const FEdgeLoop& Loop, const FVector3d& PoleDirection,
+	               bool bFacingOutward, int32 MaterialID)
+	{
+		const int32 LoopCount = Loop.Vertices.Num();
+
+		TArray<FVector3d> LoopDirections;
+		double MaxAngle = 0.0;
+		for (const int32 Vertex : Loop.Vertices)
+		{
+			const FVector3d Direction = Normalized(Mesh.GetVertex(Vertex) - Sphere.Center);
+			MaxAngle = FMath::Max(MaxAngle, AngleR(PoleDirection, Direction));
+			LoopDirections.Add(Direction);
+		}
+
+		if (MaxAngle > MaxCapAngle)
+		{
+			return false;
+		}
+
+		const int32 RingCount = FMath::Clamp(FMath::CeilToInt32(MaxAngle / CapStepAngle), 1, 32);
+
+		//ring 0 is the pole, the last ring is the loop itself
+		TArray<TArray<int32>> Rings;
+		Rings.SetNum(RingCount + 1);
+		Rings[0].Init(Mesh.AppendVertex(Sphere.Project(PoleDirection)), LoopCount);
+		for (int32 Ring = 1; Ring < RingCount; ++Ring)
+		{
+			const double Alpha = static_cast<double>(Ring) / RingCount;
+			for (const FVector3d& Direction : LoopDirections)
+			{
+				Rings[Ring].Add(Mesh.AppendVertex(Sphere.Project(SlerpDirection(PoleDirection, Direction, Alpha))));
+			}
+		}
+		Rings[RingCount] = Loop.Vertices;
+
+		FDynamicMeshAttributeSet* Attributes = Mesh.Attributes();
+		FDynamicMeshNormalOverlay* Normals = Attributes ? Attributes->PrimaryNormals() : nullptr;
+		FDynamicMeshUVOverlay* UVs = Attributes ? Attributes->PrimaryUV() : nullptr;
+		FDynamicMeshMaterialAttribute* MaterialIDs = Attributes ? Attributes->GetMaterialID() : nullptr;
+		const int32 Group = Mesh.HasTriangleGroups() ? Mesh.AllocateTriangleGroup() : 0;
+
+		//cap vertices get their own overlay elements, so the seam with the cut surface stays sharp
+		TMap<int32, FIndex2i> Elements;
+		auto GetElements = [&](int32 Vertex)
+		{
+			if (const FIndex2i* Found = Elements.Find(Vertex))
+			{
+				return *Found;
+			}
+
+			const FVector3d Direction = Normalized(Mesh.GetVertex(Vertex) - Sphere.Center);
+			FIndex2i Element{IndexConstants::InvalidID, IndexConstants::InvalidID};
+			if (Normals)
+			{
+				Element.A = Normals->AppendElement(FVector3f(bFacingOutward ? Direction : -Direction));
+			}
+			if (UVs)
+			{
+				const float U = static_cast<float>(FMath::Atan2(Direction.Y, Direction.X) / FMathd::TwoPi + 0.5);
+				const float V = static_cast<float>(FMath::Acos(FMath::Clamp(Direction.Z, -1.0, 1.0)) / FMathd::Pi);
+				Element.B = UVs->AppendElement(FVector2f(U, V));
+			}
+			return Elements.Add(Vertex, Element);
+		};
+
+		auto AddTriangle = [&](int32 A, int32 B, int32 C)
+		{
+			//the rings collapse into a single vertex at the pole
+			if (A == B || B == C || A == C)
+			{
+				return true;
+			}
+
+			FIndex3i Triangle{A, B, C};
+			const FVector3d Normal = VectorUtil::Normal(Mesh.GetVertex(A), Mesh.GetVertex(B), Mesh.GetVertex(C));
+			const FVector3d Outward = (Mesh.GetVertex(A) + Mesh.GetVertex(B) + Mesh.GetVertex(C)) / 3.0 - Sphere.Center;
+			if ((Normal.Dot(Outward) > 0.0) != bFacingOutward)
+			{
+				Swap(Triangle.B, Triangle.C);
+			}
+
+			const int32 NewTriangle = Mesh.AppendTriangle(Triangle, Group);
+			if (NewTriangle < 0)
+			{
+				return false;
+			}
+
+			const FIndex2i EA = GetElements(Triangle.A);
+			const FIndex2i EB = GetElements(Triangle.B);
+			const FIndex2i EC = GetElements(Triangle.C);
+			if (Normals)
+			{
+				Normals->SetTriangle(NewTriangle, FIndex3i(EA.A, EB.A, EC.A));
+			}
+			if (UVs)
+			{
+				UVs->SetTriangle(NewTriangle, FIndex3i(EA.B, EB.B, EC.B));
+			}
+			if (MaterialIDs)
+			{
+				MaterialIDs->SetValue(NewTriangle, MaterialID);
+			}
+			return true;
+		};
+
+		for (int32 Ring = 0; Ring < RingCount; ++Ring)
+		{
+			const TArray<int32>& Inner = Rings[Ring];
+			const TArray<int32>& Outer = Rings[Ring + 1];
+			for (int32 i = 0; i < LoopCount; ++i)
+			{
+				const int32 Next = (i + 1) % LoopCount;
+				if (!AddTriangle(Inner[i], Outer[i], Outer[Next]) || !AddTriangle(Inner[i], Outer[Next], Inner[Next]))
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	/// @brief Appends a full sphere, used when the sphere doesn't touch the surface of the mesh
+	void AppendSphere(FDynamicMesh3& Mesh, const FSphere& Sphere, bool bFacingOutward, int32 MaterialID)
+	{
+		FCSGAreaSnapshot Snapshot;
+		Snapshot.Transform = FTransform(FVector(Sphere.Center));
+		Snapshot.Radius = static_cast<float>(Sphere.Radius);
+		Snapshot.MaterialID = MaterialID;
+
+		FDynamicMesh3 SphereMesh = CSG::MakeAreaMesh(Snapshot);
+		if (!bFacingOutward)
+		{
+			SphereMesh.ReverseOrientation();
+		}
+
+		FDynamicMeshEditor Editor(&Mesh);
+		FMeshIndexMappings Mappings;
+		Editor.AppendMesh(&SphereMesh, Mappings);
+	}
+}
+
+bool CSG::TrySphereCut(const FDynamicMesh3& Mesh, const FTransform& ComponentTransform, const FCSGAreaSnapshot& Area,
+                       EBooleanOp Operation, int32 MaterialID, FDynamicMesh3& OutMesh)
+{
+	if (Operation == EBooleanOp::Union || Area.Shape != ECSGAreaShape::Sphere)
+	{
+		return false;
+	}
+
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGAnalyticCut);
+
+	//scaled spheres turn into ellipsoids
+	if (!Area.Transform.GetScale3D().IsUniform() || !ComponentTransform.GetScale3D().IsUniform())
+	{
+		return false;
+	}
+
+	FSphere Sphere;
+	Sphere.Center = ComponentTransform.InverseTransformPosition(Area.Transform.GetLocation());
+	Sphere.Radius = Area.Radius * FMath::Abs(Area.Transform.GetScale3D().X) / FMath::Abs(ComponentTransform.GetScale3D().X);
+	Sphere.Tolerance = 1e-4 * FMath::Max(1.0, Sphere.Radius);
+
+	if (Sphere.Radius <= Sphere.Tolerance)
+	{
+		return false;
+	}
+
+	const bool bIntersect = Operation == EBooleanOp::Intersection;
+
+	OutMesh = Mesh;
+	if (!SplitCrossingEdges(OutMesh, Sphere))
+	{
+		return false;
+	}
+
+	TArray<int32> Removed;
+	for (const int32 Triangle : OutMesh.TriangleIndicesItr())
+	{
+		ESide Side;
+		if (!ClassifyTriangle(OutMesh, Sphere, Triangle, Side))
+		{
+			return false;
+		}
+
+		if ((Side == ESide::Inside) != bIntersect)
+		{
+			Removed.Add(Triangle);
+		}
+	}
+
+	//the input mesh wasn't modified, so it can answer whether points on the sphere are inside it
+	TOptional<FDynamicMeshAABBTree3> Spatial;
+	TOptional<TFastWindingTree<FDynamicMesh3>> Winding;
+	auto IsInsideMesh = [&](const FVector3d& Point)
+	{
+		if (!Winding.IsSet())
+		{
+			Spatial.Emplace(&Mesh);
+			Winding.Emplace(&Spatial.GetValue());
+		}
+		return Winding->FastWindingNumber(Point) > 0.5;
+	};
+
+	for (const int32 Triangle : Removed)
+	{
+		OutMesh.RemoveTriangle(Triangle, true, false);
+	}
+
+	FMeshBoundaryLoops Boundary(&OutMesh, true);
+
+	TArray<const FEdgeLoop*> CapLoops;
+	for (const FEdgeLoop& Loop : Boundary.Loops)
+	{
+		const bool bOnSphere = Algo::AllOf(Loop.Vertices, [&](int32 Vertex)
+		{
+			return Sphere.Classify(OutMesh.GetVertex(Vertex)) == ESide::Surface;
+		});
+
+		if (bOnSphere)
+		{
+			CapLoops.Add(&Loop);
+		}
+	}
+
+	if (CapLoops.IsEmpty())
+	{
+		//the sphere doesn't touch the surface, so it's either completely inside or outside of the mesh
+		if (IsInsideMesh(Sphere.Center + FVector3d::UnitX() * Sphere.Radius))
+		{
+			AppendSphere(OutMesh, Sphere, bIntersect, MaterialID);
+		}
+		return true;
+	}
+
+	//bands between multiple loops can't be capped from a single pole
+	if (CapLoops.Num() > 1)
+	{
+		return false;
+	}
+
+	const FEdgeLoop& Loop = *CapLoops[0];
+
+	FVector3d Centroid = FVector3d::Zero();
+	for (const int32 Vertex : Loop.Vertices)
+	{
+		Centroid += OutMesh.GetVertex(Vertex);
+	}
+	Centroid /= Loop.Vertices.Num();
+
+	FVector3d PoleDirection = Centroid - Sphere.Center;
+	if (PoleDirection.SquaredLength() < Sphere.Tolerance * Sphere.Tolerance)
+	{
+		//the loop runs around a great circle, the pole is along the normal of the loop instead
+		PoleDirection = FVector3d::Zero();
+		for (int32 i = 0; i < Loop.Vertices.Num(); ++i)
+		{
+			const FVector3d A = OutMesh.GetVertex(Loop.Vertices[i]) - Sphere.Center;
+			const FVector3d B = OutMesh.GetVertex(Loop.Vertices[(i + 1) % Loop.Vertices.Num()]) - Sphere.Center;
+			PoleDirection += A.Cross(B);
+		}
+	}
+	PoleDirection = Normalized(PoleDirection);
+
+	//the cap covers the part of the sphere inside the mesh, both when intersecting and when subtracting
+	if (!IsInsideMesh(Sphere.Project(PoleDirection)))
+	{
+		PoleDirection = -PoleDirection;
+	}
+
+	return AppendCap(OutMesh, Sphere, Loop, PoleDirection, bIntersect, MaterialID);
+}
@@ -0,0 +1,79 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGStaticMeshCache.h"
+
+#include "Engine/StaticMesh.h"
+#include "GeometryScript/MeshAssetFunctions.h"
+#include "UDynamicMesh.h"
+
+FCSGStaticMeshCache& FCSGStaticMeshCache::Get()
+{
+	static FCSGStaticMeshCache Cache;
+	return Cache;
+}
+
+FCSGStaticMeshCache::FCSGStaticMeshCache()
+{
+	FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FCSGStaticMeshCache::PurgeStaleEntries);
+}
+
+TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> FCSGStaticMeshCache::FindOrConvert(
+	UStaticMesh* Mesh)
+{
+	check(IsInGameThread());
+
+	if (!Mesh)
+	{
+		return nullptr;
+	}
+
+	if (const auto* Cached = Meshes.Find(TObjectKey<UStaticMesh>(Mesh)))
+	{
+		return *Cached;
+	}
+
+	UDynamicMesh* Converted = NewObject<UDynamicMesh>();
+	EGeometryScriptOutcomePins Result;
+	UGeometryScriptLibrary_StaticMeshFunctions::CopyMeshFromStaticMesh(Mesh, Converted, {}, {}, Result);
+
+	//failures aren't cached, the asset might still be compiling
+	if (Result != EGeometryScriptOutcomePins::Success)
+	{
+		return nullptr;
+	}
+
+	TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> Shared =
+		MakeShared<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>(MoveTemp(*Converted->ExtractMesh()));
+	Meshes.Add(TObjectKey<UStaticMesh>(Mesh), Shared);
+
+#if WITH_EDITOR
+	Mesh->OnPostMeshBuild().RemoveAll(this);
+	Mesh->OnPostMeshBuild().AddRaw(this, &FCSGStaticMeshCache::OnMeshBuilt);
+#endif
+
+	return Shared;
+}
+
+void FCSGStaticMeshCache::Invalidate(const UStaticMesh* Mesh)
+{
+	Meshes.Remove(TObjectKey<UStaticMesh>(Mesh));
+}
+
+#if WITH_EDITOR
+void FCSGStaticMeshCache::OnMeshBuilt(UStaticMesh* Mesh)
+{
+	Invalidate(Mesh);
+}
+#endif
+
+void FCSGStaticMeshCache::PurgeStaleEntries()
+{
+	for (auto It = Meshes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,39 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "UObject/ObjectKey.h"
+
+class UStaticMesh;
+
+/// @brief Dynamic mesh versions of static mesh assets, shared by all CSG components using the same asset
+///
+/// Assets only get converted the first time they are requested,
+/// entries are dropped when the asset gets rebuilt in the editor or garbage collected
+class FCSGStaticMeshCache
+{
+public:
+	static FCSGStaticMeshCache& Get();
+
+	/// Returns the converted mesh of the asset, converting it when it isn't cached yet
+	///
+	/// @param Mesh Asset to get the dynamic mesh for
+	/// @return Converted mesh, or nullptr when the asset couldn't be converted
+	TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> FindOrConvert(UStaticMesh* Mesh);
+
+	/// @brief Drops the cached version of the asset, the next request will convert it again
+	void Invalidate(const UStaticMesh* Mesh);
+
+private:
+	FCSGStaticMeshCache();
+
+	void PurgeStaleEntries();
+
+#if WITH_EDITOR
+	void OnMeshBuilt(UStaticMesh* Mesh);
+#endif
+
+	TMap<TObjectKey<UStaticMesh>, TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>> Meshes;
+};
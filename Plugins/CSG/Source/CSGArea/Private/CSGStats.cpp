@@ -0,0 +1,24 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGStats.h"
+
+DEFINE_LOG_CATEGORY(LogCSG);
+
+DEFINE_STAT(STAT_CSGSchedule);
+DEFINE_STAT(STAT_CSGFetchSource);
+DEFINE_STAT(STAT_CSGGenerateCutter);
+DEFINE_STAT(STAT_CSGEvaluate);
+DEFINE_STAT(STAT_CSGBoolean);
+DEFINE_STAT(STAT_CSGAnalyticCut);
+DEFINE_STAT(STAT_CSGUnionFold);
+DEFINE_STAT(STAT_CSGEvaluateSdf);
+DEFINE_STAT(STAT_CSGPostProcess);
+DEFINE_STAT(STAT_CSGApplyResult);
+DEFINE_STAT(STAT_CSGCollision);
+
+DEFINE_STAT(STAT_CSGRebuilds);
+DEFINE_STAT(STAT_CSGInputTriangles);
+DEFINE_STAT(STAT_CSGOutputTriangles);
+DEFINE_STAT(STAT_CSGQueueLength);
+DEFINE_STAT(STAT_CSGScratchMeshes);
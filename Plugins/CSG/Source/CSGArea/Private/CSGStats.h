@@ -0,0 +1,39 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCSG, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("CSG"), STATGROUP_CSG, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Schedule Rebuilds"), STAT_CSGSchedule, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fetch Source Mesh"), STAT_CSGFetchSource, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Cutter"), STAT_CSGGenerateCutter, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Evaluate"), STAT_CSGEvaluate, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Boolean"), STAT_CSGBoolean, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Analytic Cut"), STAT_CSGAnalyticCut, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Union Fold"), STAT_CSGUnionFold, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SDF Evaluate"), STAT_CSGEvaluateSdf, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Post Process"), STAT_CSGPostProcess, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Result"), STAT_CSGApplyResult, STATGROUP_CSG, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Collision From Mesh"), STAT_CSGCollision, STATGROUP_CSG, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rebuilds"), STAT_CSGRebuilds, STATGROUP_CSG, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Input Triangles"), STAT_CSGInputTriangles, STATGROUP_CSG, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Output Triangles"), STAT_CSGOutputTriangles, STATGROUP_CSG, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Queued Components"), STAT_CSGQueueLength, STATGROUP_CSG, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Scratch Meshes"), STAT_CSGScratchMeshes, STATGROUP_CSG, );
+
+/// @brief Times the scope for stat CSG and shows it as a named event in Unreal Insights
+///
+/// The cycle counter traces its own event while the CPU channel is on, the trace scope only stands in for it in
+/// builds without stats
+#if STATS
+#define CSG_SCOPE_CYCLE_COUNTER(Stat) SCOPE_CYCLE_COUNTER(Stat)
+#else
+#define CSG_SCOPE_CYCLE_COUNTER(Stat) TRACE_CPUPROFILER_EVENT_SCOPE(Stat)
+#endif
@@ -3,7 +3,14 @@
 
 #include "Components/CSGAreaComponent.h"
 
+#include "CSGAreaSubsystem.h"
+#include "CSGStaticMeshCache.h"
+#include "CSGStats.h"
 #include "PluginSettings.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/PlayerController.h"
 
 
 // Sets default values for this component's properties
@@ -13,11 +20,9 @@ UCSGAreaComponent::UCSGAreaComponent()
 	// off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = false;
 
-	CollisionChannel = GetDefault<UPluginSettings>()->CollisionChannel;
-
-	UCSGAreaComponent::SetCollisionResponseToAllChannels(ECR_Ignore);
-	UCSGAreaComponent::SetCollisionResponseToChannel(CollisionChannel, ECR_Overlap);
-	UCSGAreaComponent::SetCollisionObjectType(CollisionChannel);
+	//components find their areas through the area index, the physics scene doesn't need to know about them
+	UCSGAreaComponent::SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+	SetGenerateOverlapEvents(false);
 
 #if WITH_EDITORONLY_DATA
 	if (!IsRunningGame())
@@ -43,13 +48,31 @@ void UCSGAreaComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// ...
+	if (UCSGAreaSubsystem* AreaIndex = GetWorld()->GetSubsystem<UCSGAreaSubsystem>())
+	{
+		AreaIndex->RegisterArea(this);
+	}
+}
+
+void UCSGAreaComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UCSGAreaSubsystem* AreaIndex = GetWorld()->GetSubsystem<UCSGAreaSubsystem>())
+	{
+		AreaIndex->UnregisterArea(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void UCSGAreaComponent::OnRegister()
 {
 	Super::OnRegister();
 
+	if (Shape != ECSGAreaShape::Sphere)
+	{
+		SetSphereRadius(GetCutterBoundingRadius(), false);
+	}
+
 #if WITH_EDITORONLY_DATA
 	if (!IsRunningGame())
 	{
@@ -58,6 +81,182 @@ void UCSGAreaComponent::OnRegister()
 #endif
 }
 
+void UCSGAreaComponent::UpdateBodySetup()
+{
+	Super::UpdateBodySetup();
+
+	//the body setup is rebuilt whenever the sphere radius changes
+	OnAreaChanged.Broadcast(this);
+}
+
+ECSGAreaShape UCSGAreaComponent::GetCutterShape() const
+{
+	if ((Shape == ECSGAreaShape::Convex || Shape == ECSGAreaShape::StaticMesh) && !CutterStaticMesh)
+	{
+		return ECSGAreaShape::Sphere;
+	}
+	return Shape;
+}
+
+FVector UCSGAreaComponent::GetCutterExtent() const
+{
+	switch (GetCutterShape())
+	{
+	case ECSGAreaShape::Box:
+		return BoxExtent;
+	case ECSGAreaShape::Capsule:
+		return FVector(CapsuleRadius, CapsuleRadius, FMath::Max(CapsuleRadius, CapsuleHalfHeight));
+	default:
+		return FVector::ZeroVector;
+	}
+}
+
+float UCSGAreaComponent::GetCutterBoundingRadius() const
+{
+	switch (GetCutterShape())
+	{
+	case ECSGAreaShape::Box:
+		return BoxExtent.Size();
+	case ECSGAreaShape::Capsule:
+		return FMath::Max(CapsuleRadius, CapsuleHalfHeight);
+	case ECSGAreaShape::Convex:
+	case ECSGAreaShape::StaticMesh:
+		{
+			const FBox Bounds = CutterStaticMesh->GetBoundingBox();
+			return FVector::Max(Bounds.Min.GetAbs(), Bounds.Max.GetAbs()).Size();
+		}
+	default:
+		return GetUnscaledSphereRadius();
+	}
+}
+
+int32 UCSGAreaComponent::GetEffectiveCutterResolution() const
+{
+	if (ResolutionPolicy == ECSGCutterResolutionPolicy::Fixed)
+	{
+		return CutterResolution;
+	}
+
+	const UPluginSettings* Settings = GetDefault<UPluginSettings>();
+	const double Radius = GetScaledSphereRadius();
+
+	//a box sphere face spans a quarter of the circumference
+	int32 Resolution = FMath::CeilToInt32(UE_HALF_PI * Radius / FMath::Max(0.1f, Settings->CutterEdgeLength)) + 1;
+
+	const APlayerController* PlayerController = GetWorld() ? GetWorld()->GetFirstPlayerController() : nullptr;
+	if (PlayerController && PlayerController->PlayerCameraManager)
+	{
+		const APlayerCameraManager* Camera = PlayerController->PlayerCameraManager;
+		const double Distance = FVector::Distance(Camera->GetCameraLocation(), GetComponentLocation());
+		const double HalfFOV = FMath::DegreesToRadians(FMath::Clamp(Camera->GetFOVAngle(), 1.0f, 170.0f) * 0.5);
+
+		//fraction of the screen covered by the sphere, a camera inside the area sees it covering everything
+		const double ScreenSize = Distance > Radius ? Radius / (Distance * FMath::Tan(HalfFOV)) : 1.0;
+		const int32 ScreenResolution = FMath::CeilToInt32(FMath::Min(ScreenSize, 1.0) *
+			Settings->CutterFullScreenResolution) + 1;
+		Resolution = FMath::Min(Resolution, ScreenResolution);
+	}
+
+	return FMath::Clamp(Resolution, Settings->MinCutterResolution,
+	                    FMath::Max(Settings->MinCutterResolution, Settings->MaxCutterResolution));
+}
+
+void UCSGAreaComponent::UpdateCutterShape()
+{
+	CutterMeshes.Reset();
+	CutterMeshSource.Reset();
+
+	if (Shape != ECSGAreaShape::Sphere)
+	{
+		//resizing the sphere broadcasts OnAreaChanged through UpdateBodySetup
+		SetSphereRadius(GetCutterBoundingRadius());
+	}
+	else
+	{
+		OnAreaChanged.Broadcast(this);
+	}
+
+#if WITH_EDITORONLY_DATA
+	if (!IsRunningGame() && SphereComponent)
+	{
+		SphereComponent->SetRelativeScale3D(FVector{SphereRadius / 50});
+	}
+#endif
+}
+
+#if WITH_EDITOR
+void UCSGAreaComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	UpdateCutterShape();
+}
+#endif
+
+TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> UCSGAreaComponent::GetCutterMesh(
+	int32 MaterialID) const
+{
+	const ECSGAreaShape CutterShape = GetCutterShape();
+
+	TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> Source;
+	if (CutterShape == ECSGAreaShape::Convex || CutterShape == ECSGAreaShape::StaticMesh)
+	{
+		Source = FCSGStaticMeshCache::Get().FindOrConvert(CutterStaticMesh);
+		if (!Source)
+		{
+			return nullptr;
+		}
+	}
+
+	const float Radius = GetUnscaledSphereRadius();
+
+	int32 Resolution = GetEffectiveCutterResolution();
+	if (ResolutionPolicy == ECSGCutterResolutionPolicy::Adaptive && FMath::Abs(Resolution - CutterMeshResolution) <= 1)
+	{
+		//small changes in screen size would otherwise regenerate the cutter and rebuild every overlapped component
+		Resolution = CutterMeshResolution;
+	}
+
+	if (CutterMeshRadius != Radius || CutterMeshResolution != Resolution || CutterMeshSource != Source)
+	{
+		//rebuilds in flight keep their own reference to the old meshes
+		CutterMeshes.Reset();
+		CutterMeshRadius = Radius;
+		CutterMeshResolution = Resolution;
+		CutterMeshSource = Source;
+	}
+
+	if (const auto* Found = CutterMeshes.Find(MaterialID))
+	{
+		return *Found;
+	}
+
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGGenerateCutter);
+
+	UE::Geometry::FDynamicMesh3 Mesh;
+	switch (CutterShape)
+	{
+	case ECSGAreaShape::Box:
+		Mesh = CSG::MakeBoxCutter(BoxExtent, MaterialID);
+		break;
+	case ECSGAreaShape::Capsule:
+		Mesh = CSG::MakeCapsuleCutter(CapsuleRadius, CapsuleHalfHeight, Resolution, MaterialID);
+		break;
+	case ECSGAreaShape::Convex:
+		Mesh = CSG::MakeConvexCutter(*Source, MaterialID);
+		break;
+	case ECSGAreaShape::StaticMesh:
+		Mesh = *Source;
+		CSG::AssignMaterialID(Mesh, MaterialID);
+		break;
+	default:
+		Mesh = CSG::MakeSphereCutter(Radius, Resolution, MaterialID);
+		break;
+	}
+
+	return CutterMeshes.Add(MaterialID, MakeShared<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>(MoveTemp(Mesh)));
+}
+
 void UCSGAreaComponent::OnComponentDestroyed(bool bDestroyingHierarchy)
 {
 	Super::OnComponentDestroyed(bDestroyingHierarchy);
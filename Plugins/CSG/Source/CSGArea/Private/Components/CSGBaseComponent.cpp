@@ -3,19 +3,38 @@
 
 #include "Components/CSGBaseComponent.h"
 
+#include "CSGAreaSubsystem.h"
+#include "CSGRebuildSubsystem.h"
+#include "CSGStats.h"
 #include "Components/CSGAreaComponent.h"
+#include "Async/Async.h"
 #include "GeometryScript/CollisionFunctions.h"
-#include "GeometryScript/MeshBooleanFunctions.h"
-#include "GeometryScript/MeshPrimitiveFunctions.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 
+namespace
+{
+	/// @brief Version of the data written by SaveCSGState
+	constexpr int32 CSGStateVersion = 1;
+}
+
+bool FCSGFingerprint::VisualEquals(const FCSGFingerprint& Other) const
+{
+	return bReverse == Other.bReverse && ComponentTransform.Equals(Other.ComponentTransform) &&
+		CSG::AreasEqual(Areas, Other.Areas);
+}
+
+bool FCSGFingerprint::CollisionEquals(const FCSGFingerprint& Other) const
+{
+	return bReverse == Other.bReverse && ComponentTransform.Equals(Other.ComponentTransform) &&
+		CSG::AreasEqual(CollisionAreas, Other.CollisionAreas);
+}
 
 // Sets default values for this component's properties
 UCSGBaseComponent::UCSGBaseComponent()
 {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
-	PrimaryComponentTick.bStartWithTickEnabled = true;
+	//rebuilds are driven by area and transform events, which queue the component with UCSGRebuildSubsystem
+	PrimaryComponentTick.bCanEverTick = false;
 }
 
 // Called when the game starts
@@ -23,147 +42,792 @@ void UCSGBaseComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	int i = 0;
-	for (; i < Materials.Num(); ++i)
+	//the baked static meshes stand in for the component
+	if (bCSGBaked)
 	{
-		SetMaterial(i, Materials[i]);
+		SetVisibility(false);
+		SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		return;
 	}
-	SetMaterial(i, CSGMaterial);
 
-	MarkRenderStateDirty();
+	//areas around the component request rebuilds through the index from now on
+	UpdateSourceBounds();
+	if (UCSGAreaSubsystem* AreaIndex = GetWorld()->GetSubsystem<UCSGAreaSubsystem>())
+	{
+		AreaIndex->UpdateCSGComponent(this);
+	}
+
+	//components of a streamed in level pick up the result they had when the level was streamed out,
+	//the stored state is consumed even when a save game already restored one
+	if (bPersistCSGResult)
+	{
+		if (UCSGRebuildSubsystem* Scheduler = GetWorld()->GetSubsystem<UCSGRebuildSubsystem>())
+		{
+			TArray<uint8> State;
+			if (Scheduler->TakeStreamedState(this, State) && !RestoredResult)
+			{
+				LoadCSGState(State);
+			}
+		}
+	}
 
-	MeshPool = NewObject<UDynamicMeshPool>(this);
+	RequestRebuild();
 }
 
+void UCSGBaseComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bPersistCSGResult && EndPlayReason == EEndPlayReason::RemovedFromWorld)
+	{
+		if (UCSGRebuildSubsystem* Scheduler = GetWorld()->GetSubsystem<UCSGRebuildSubsystem>())
+		{
+			TArray<uint8> State;
+			SaveCSGState(State);
+			Scheduler->StoreStreamedState(this, MoveTemp(State));
+		}
+	}
+
+	if (UCSGAreaSubsystem* AreaIndex = GetWorld()->GetSubsystem<UCSGAreaSubsystem>())
+	{
+		AreaIndex->UnregisterCSGComponent(this);
+	}
 
-void UCSGBaseComponent::RebuildMesh(UDynamicMesh* OutMesh, UDynamicMesh* FullMesh) const
+	if (UCSGRebuildSubsystem* Scheduler = GetWorld()->GetSubsystem<UCSGRebuildSubsystem>())
+	{
+		Scheduler->Dequeue(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UCSGBaseComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
 {
-	const auto DynamicMesh = OutMesh;
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
 
-	TArray<UPrimitiveComponent*> Overlapping;
-	GetOwner()->GetOverlappingComponents(Overlapping);
+	if (HasBegunPlay())
+	{
+		if (UCSGAreaSubsystem* AreaIndex = GetWorld()->GetSubsystem<UCSGAreaSubsystem>())
+		{
+			AreaIndex->UpdateCSGComponent(this);
+		}
+	}
 
-	UDynamicMesh* BaseMesh = FullMesh;
+	RequestRebuild();
+}
 
-	TArray<UDynamicMesh*> MeshPieces;
 
-	for (const auto OverlappingComponent : Overlapping)
+void UCSGBaseComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	SyncMaterials();
+}
+
+void UCSGBaseComponent::OnComponentDestroyed(bool bDestroyingHierarchy)
+{
+	DEC_DWORD_STAT_BY(STAT_CSGScratchMeshes, ScratchStats.MeshCount);
+
+	Super::OnComponentDestroyed(bDestroyingHierarchy);
+}
+
+void UCSGBaseComponent::SyncMaterials()
+{
+	//every changed slot marks the render state dirty, so the slots already set are skipped
+	auto Sync = [this](int32 Slot, UMaterialInterface* Material)
 	{
-		if (const auto* Component = Cast<UCSGAreaComponent>(OverlappingComponent))
+		if (GetMaterial(Slot) != Material)
 		{
-			UDynamicMesh* TempMesh = MeshPool->RequestMesh();
+			SetMaterial(Slot, Material);
+		}
+	};
 
-			UGeometryScriptLibrary_MeshPrimitiveFunctions::AppendSphereBox(
-				TempMesh, {}, Component->GetComponentTransform(), Component->GetUnscaledSphereRadius());
+	for (int32 i = 0; i < Materials.Num(); ++i)
+	{
+		Sync(i, Materials[i]);
+	}
+	Sync(Materials.Num(), CSGMaterial);
+	for (int32 i = 0; i < AreaMaterials.Num(); ++i)
+	{
+		Sync(Materials.Num() + 1 + i, AreaMaterials[i]);
+	}
 
-			int MaterialIndex = Materials.Num();
-			TempMesh->EditMesh([MaterialIndex](FDynamicMesh3& Mesh)
-			{
-				// ReSharper disable once CppTooWideScope
-				const auto Material = Mesh.Attributes()->GetMaterialID();
+	//slots of area materials no area uses anymore are dropped
+	const int32 SlotCount = Materials.Num() + 1 + AreaMaterials.Num();
+	if (GetNumMaterials() > SlotCount)
+	{
+		SetNumMaterials(SlotCount);
+	}
+}
+
+int32 UCSGBaseComponent::GetAreaMaterialID(const UCSGAreaComponent* Area,
+                                           TArray<UMaterialInterface*>& InOutAreaMaterials) const
+{
+	UMaterialInterface* Material = Area->CutMaterial;
+	if (!Material || Material == CSGMaterial)
+	{
+		return Materials.Num();
+	}
+	return Materials.Num() + 1 + InOutAreaMaterials.AddUnique(Material);
+}
+
+void UCSGBaseComponent::MarkCSGDirty()
+{
+	LastFingerprint.Reset();
+	bVisualSourceFetched = false;
+	bCollisionSourceFetched = false;
+	CachedSourceBounds = FBox(ForceInit);
+
+	//a job in flight keeps its own reference to the old chunks
+	VisualChunks.Reset();
+	CollisionChunks.Reset();
+	CollisionProxy.Reset();
+	VisualIncremental.Reset();
+	CollisionIncremental.Reset();
+	VisualSdf.Reset();
+	CollisionSdf.Reset();
+
+	//the source mesh might have changed size
+	if (HasBegunPlay())
+	{
+		UpdateSourceBounds();
+		if (UCSGAreaSubsystem* AreaIndex = GetWorld()->GetSubsystem<UCSGAreaSubsystem>())
+		{
+			AreaIndex->UpdateCSGComponent(this);
+		}
+	}
+
+	RequestRebuild();
+}
+
+void UCSGBaseComponent::SaveCSGState(TArray<uint8>& OutState) const
+{
+	TArray<uint8> VisualData;
+	CSG::SaveMesh(*GetMesh(), VisualData);
 
-				if (Material)
-				{
-					for (const auto Triangle : Mesh.TriangleIndicesItr())
-					{
-						Material->SetValue(Triangle, MaterialIndex);
-					}
-				}
-			});
+	//the collision mesh stays in its scratch mesh after cooking
+	TArray<uint8> CollisionData;
+	const int32 CollisionIndex = static_cast<int32>(ECSGScratchMesh::CollisionResult);
+	if (ScratchMeshes.IsValidIndex(CollisionIndex) && ScratchMeshes[CollisionIndex])
+	{
+		CSG::SaveMesh(ScratchMeshes[CollisionIndex]->GetMeshRef(), CollisionData);
+	}
+
+	OutState.Reset();
+	FMemoryWriter Writer(OutState);
+	int32 Version = CSGStateVersion;
+	Writer << Version;
+	Writer << VisualData;
+	Writer << CollisionData;
+}
+
+bool UCSGBaseComponent::LoadCSGState(const TArray<uint8>& State)
+{
+	FMemoryReader Reader(State);
+	int32 Version = 0;
+	TArray<uint8> VisualData;
+	TArray<uint8> CollisionData;
+	Reader << Version;
+	if (Version != CSGStateVersion)
+	{
+		return false;
+	}
+	Reader << VisualData;
+	Reader << CollisionData;
+
+	TSharedPtr<FCSGRebuildResult> Result = MakeShared<FCSGRebuildResult>();
+	Result->bHasVisual = CSG::LoadMesh(VisualData, Result->VisualMesh);
+	Result->bHasCollision = CSG::LoadMesh(CollisionData, Result->CollisionMesh);
+	if (Reader.IsError() || !Result->bHasVisual)
+	{
+		return false;
+	}
+
+	RestoredResult = MoveTemp(Result);
+	RequestRebuild();
+	return true;
+}
+
+void UCSGBaseComponent::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	if (Ar.IsSaveGame() && bPersistCSGResult)
+	{
+		TArray<uint8> State;
+		if (Ar.IsSaving())
+		{
+			SaveCSGState(State);
+		}
 
-			UGeometryScriptLibrary_MeshBooleanFunctions::ApplyMeshBoolean(
-				TempMesh, {},
-				BaseMesh, GetComponentTransform(),
-				EGeometryScriptBooleanOperation::Intersection,
-				{true, true, 0.01, true});
+		Ar << State;
 
-			MeshPieces.Push(TempMesh);
+		if (Ar.IsLoading() && !State.IsEmpty())
+		{
+			LoadCSGState(State);
 		}
 	}
+}
 
-	//only reset the dynamic mesh now since the OutMesh might also be used for FullMesh
-	DynamicMesh->Reset();
+void UCSGBaseComponent::RequestRebuild()
+{
+	//events also fire while registering in the editor, the first rebuild is requested from BeginPlay
+	if (HasBegunPlay() && !bCSGBaked)
+	{
+		if (UCSGRebuildSubsystem* Scheduler = GetWorld()->GetSubsystem<UCSGRebuildSubsystem>())
+		{
+			Scheduler->Enqueue(this);
+		}
+	}
+}
 
-	for (const auto Piece : MeshPieces)
+void UCSGBaseComponent::RequestDeferredRebuild()
+{
+	if (HasBegunPlay() && !bCSGBaked)
 	{
-		UGeometryScriptLibrary_MeshBooleanFunctions::ApplyMeshBoolean(
-			DynamicMesh, GetComponentTransform(),
-			Piece, {},
-			EGeometryScriptBooleanOperation::Union,
-			{true, true, 0.01, true});
+		if (UCSGRebuildSubsystem* Scheduler = GetWorld()->GetSubsystem<UCSGRebuildSubsystem>())
+		{
+			Scheduler->EnqueueWhenDue(this);
+		}
 	}
 }
 
-void UCSGBaseComponent::ReverseRebuildMesh(UDynamicMesh* OutMesh) const
+bool UCSGBaseComponent::IsRebuildDue(double Now) const
 {
-	TArray<UPrimitiveComponent*> Overlapping;
-	GetOwner()->GetOverlappingComponents(Overlapping);
+	if (PendingRebuild.IsValid())
+	{
+		return PendingRebuild.IsReady();
+	}
+	return !bCollisionStale || IsCollisionUpdateDue(Now);
+}
 
-	for (const auto OverlappingComponent : Overlapping)
+FBox UCSGBaseComponent::GetCSGSourceBounds() const
+{
+	const FBox LocalBounds = GetLocalSourceBounds();
+	return LocalBounds.IsValid ? LocalBounds.TransformBy(GetComponentTransform()) : FBox(ForceInit);
+}
+
+FBox UCSGBaseComponent::GetLocalSourceBounds() const
+{
+	return CachedSourceBounds;
+}
+
+void UCSGBaseComponent::UpdateSourceBounds()
+{
+	//the sources stay in their scratch meshes, so the next rebuild doesn't fetch them again
+	CachedSourceBounds = GetMeshBounds(FetchVisualSource()) + GetMeshBounds(FetchCollisionSource());
+}
+
+FBox UCSGBaseComponent::GetMeshBounds(const UE::Geometry::FDynamicMesh3& Mesh)
+{
+	//an empty FAxisAlignedBox3d converts into an inverted but valid FBox
+	const UE::Geometry::FAxisAlignedBox3d Bounds = Mesh.GetBounds(true);
+	return Bounds.IsEmpty() ? FBox(ForceInit) : FBox(Bounds.Min, Bounds.Max);
+}
+
+bool UCSGBaseComponent::IsAffectedBy(const UCSGAreaComponent* Area, const FBox& WorldBounds) const
+{
+	//the index only compares boxes, the areas are spheres around their shape
+	return AcceptsLayers(Area->CSGLayers) && FMath::SphereAABBIntersection(
+		Area->GetComponentLocation(), FMath::Square(Area->GetCutterWorldRadius()), WorldBounds);
+}
+
+void UCSGBaseComponent::GatherAreas(TArray<const UCSGAreaComponent*>& OutAreas) const
+{
+	const UCSGAreaSubsystem* AreaIndex = GetWorld()->GetSubsystem<UCSGAreaSubsystem>();
+	if (!AreaIndex)
 	{
-		if (const auto Component = Cast<UCSGAreaComponent>(OverlappingComponent))
+		return;
+	}
+
+	const FBox SourceBounds = GetCSGSourceBounds();
+	TArray<UCSGAreaComponent*> Candidates;
+	AreaIndex->QueryAreas(SourceBounds, Candidates);
+
+	for (const UCSGAreaComponent* Area : Candidates)
+	{
+		if (IsAffectedBy(Area, SourceBounds))
 		{
-			UDynamicMesh* TempMesh = MeshPool->RequestMesh();
+			OutAreas.Add(Area);
+		}
+	}
+}
 
-			UGeometryScriptLibrary_MeshPrimitiveFunctions::AppendSphereBox(
-				TempMesh, {}, Component->GetComponentTransform(), Component->GetUnscaledSphereRadius());
+FCSGFingerprint UCSGBaseComponent::MakeFingerprint(const TArray<const UCSGAreaComponent*>& AllAreas,
+                                                   TArray<UMaterialInterface*>& OutAreaMaterials) const
+{
+	FCSGFingerprint Fingerprint;
+	Fingerprint.ComponentTransform = GetComponentTransform();
+	Fingerprint.bReverse = bDoReverseCSG;
 
-			int MaterialIndex = Materials.Num();
-			TempMesh->EditMesh([MaterialIndex](FDynamicMesh3& Mesh)
-			{
-				// ReSharper disable once CppTooWideScope
-				const auto Material = Mesh.Attributes()->GetMaterialID();
+	//layers are checked before anything gets built for the area
+	TArray<const UCSGAreaComponent*> Areas = AllAreas.FilterByPredicate([this](const UCSGAreaComponent* Area)
+	{
+		return AcceptsLayers(Area->CSGLayers);
+	});
 
-				if (Material)
-				{
-					for (const auto Triangle : Mesh.TriangleIndicesItr())
-					{
-						Material->SetValue(Triangle, MaterialIndex);
-					}
-				}
-			});
+	//area materials keep their slot while an area still uses them, so unchanged results keep their material IDs
+	OutAreaMaterials.Reset();
+	for (UMaterialInterface* Material : AreaMaterials)
+	{
+		if (Areas.ContainsByPredicate([Material](const UCSGAreaComponent* Area)
+		{
+			return Area->CutMaterial == Material;
+		}))
+		{
+			OutAreaMaterials.Add(Material);
+		}
+	}
 
-			UGeometryScriptLibrary_MeshBooleanFunctions::ApplyMeshBoolean(
-				OutMesh, GetComponentTransform(),
-				TempMesh, {},
-				EGeometryScriptBooleanOperation::Subtract,
-				{true, true, 0.01, true});
+	Fingerprint.Areas.Reserve(Areas.Num());
+	for (const auto Component : Areas)
+	{
+		const bool bVisual = (Component->CSGLayers & CSGLayers) != 0;
+		const bool bCollision = (Component->CSGLayers & CollisionCSGLayers) != 0;
+
+		FCSGAreaSnapshot Snapshot;
+		Snapshot.Component = FObjectKey{Component};
+		Snapshot.Transform = Component->GetComponentTransform();
+		Snapshot.Radius = Component->GetUnscaledSphereRadius();
+		Snapshot.Shape = Component->GetCutterShape();
+		Snapshot.Extent = Component->GetCutterExtent();
+		Snapshot.MaterialID = GetAreaMaterialID(Component, OutAreaMaterials);
+		Snapshot.Cutter = Component->GetCutterMesh(Snapshot.MaterialID);
+
+		if (bCollision)
+		{
+			Fingerprint.CollisionAreas.Add(Snapshot);
+		}
+		if (bVisual)
+		{
+			Fingerprint.Areas.Add(MoveTemp(Snapshot));
 		}
 	}
+
+	//overlap order isn't stable between frames, so sort to make the comparison order independent
+	auto ByComponent = [](const FCSGAreaSnapshot& A, const FCSGAreaSnapshot& B)
+	{
+		return A.Component < B.Component;
+	};
+	Fingerprint.Areas.Sort(ByComponent);
+	Fingerprint.CollisionAreas.Sort(ByComponent);
+
+	return Fingerprint;
 }
 
-// Called every frame
-void UCSGBaseComponent::TickComponent(float DeltaTime, ELevelTick TickType,
-                                      FActorComponentTickFunction* ThisTickFunction)
+void UCSGBaseComponent::MakeRebuildInput(const FCSGFingerprint& Fingerprint, FCSGRebuildInput& OutInput,
+                                         bool bUseCaches)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGFetchSource);
+
+	OutInput.ComponentTransform = Fingerprint.ComponentTransform;
+	OutInput.Areas = Fingerprint.Areas;
+	OutInput.CollisionAreas = Fingerprint.CollisionAreas;
+	OutInput.CSGMaterialID = Materials.Num();
+	OutInput.bReverse = Fingerprint.bReverse;
+	OutInput.bAnalyticSphereCut = bAnalyticSphereCut;
+	OutInput.bAnalyticConvexCut = bAnalyticConvexCut;
+
+	OutInput.PostProcess.bEnabled = bPostProcess;
+	OutInput.PostProcess.WeldTolerance = WeldTolerance;
+	OutInput.PostProcess.TriangleBudget = TriangleBudget;
+	OutInput.PostProcess.CutRegionRings = CutRegionRings;
+
+	OutInput.MaxChunkTriangles = bUseCaches ? MaxChunkTriangles : 0;
+	if (OutInput.MaxChunkTriangles > 0)
+	{
+		if (!VisualChunks)
+		{
+			VisualChunks = MakeShared<FCSGChunkCache, ESPMode::ThreadSafe>();
+			CollisionChunks = MakeShared<FCSGChunkCache, ESPMode::ThreadSafe>();
+		}
+		OutInput.VisualChunks = VisualChunks;
+		OutInput.CollisionChunks = CollisionChunks;
+	}
 
-	if (TickType == LEVELTICK_All)
+	if (Backend == ECSGBackend::SignedDistanceField)
 	{
-		const auto CollisionMesh = MeshPool->RequestMesh();
-		GetCollisionMesh(CollisionMesh);
+		if (!bUseCaches)
+		{
+			//a one off evaluation mustn't leave anything behind in the fields the scheduled rebuilds start from
+			OutInput.VisualSdf = CSG::MakeSdfCache(SdfVoxelSize);
+			OutInput.CollisionSdf = CSG::MakeSdfCache(SdfVoxelSize);
+		}
+		else
+		{
+			if (!VisualSdf)
+			{
+				VisualSdf = CSG::MakeSdfCache(SdfVoxelSize);
+				CollisionSdf = CSG::MakeSdfCache(SdfVoxelSize);
+			}
+			OutInput.VisualSdf = VisualSdf;
+			OutInput.CollisionSdf = CollisionSdf;
+		}
+	}
 
-		if (bDoReverseCSG)
+	OutInput.bIncremental = bUseCaches && bIncrementalCSG && bDoReverseCSG;
+	if (OutInput.bIncremental)
+	{
+		if (!VisualIncremental)
 		{
-			GetVisualMesh(GetDynamicMesh()->Reset());
+			VisualIncremental = MakeShared<FCSGIncrementalCache, ESPMode::ThreadSafe>();
+			CollisionIncremental = MakeShared<FCSGIncrementalCache, ESPMode::ThreadSafe>();
+		}
+		OutInput.VisualIncremental = VisualIncremental;
+		OutInput.CollisionIncremental = CollisionIncremental;
+	}
+
+	//built fields and chunks replace the source meshes, so they are only copied for the first rebuild after
+	//MarkCSGDirty. The field takes precedence over the chunks, like in CSG::Evaluate
+	auto IsCached = [](const TSharedPtr<FCSGSdfCache, ESPMode::ThreadSafe>& Sdf,
+	                   const TSharedPtr<FCSGChunkCache, ESPMode::ThreadSafe>& Chunks)
+	{
+		return Sdf ? CSG::IsSdfBuilt(*Sdf) : Chunks && Chunks->bBuilt;
+	};
+	const bool bVisualCached = IsCached(OutInput.VisualSdf, OutInput.VisualChunks);
+	const bool bCollisionCached = IsCached(OutInput.CollisionSdf, OutInput.CollisionChunks);
 
-			ReverseRebuildMesh(GetDynamicMesh());
+	//a one off evaluation brings its own copies of the sources, see EvaluateCSG
+	if (!bUseCaches)
+	{
+		return;
+	}
 
-			ReverseRebuildMesh(CollisionMesh);
+	//the source meshes stay in their scratch meshes until MarkCSGDirty, every other rebuild copies from them
+	if (OutInput.bEvaluateVisual && !bVisualCached)
+	{
+		OutInput.VisualMesh = FetchVisualSource();
+	}
+
+	if (OutInput.bEvaluateCollision && !bCollisionCached)
+	{
+		if (CollisionProxyTriangleCount > 0)
+		{
+			if (!CollisionProxy)
+			{
+				UE::Geometry::FDynamicMesh3 Proxy = FetchCollisionSource();
+				CSG::Simplify(Proxy, CollisionProxyTriangleCount);
+				CollisionProxy = MakeShared<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>(MoveTemp(Proxy));
+			}
+			OutInput.CollisionMesh = *CollisionProxy;
 		}
 		else
 		{
-			const auto VisualMesh = MeshPool->RequestMesh();
-			GetVisualMesh(VisualMesh);
+			OutInput.CollisionMesh = FetchCollisionSource();
+		}
+	}
+}
 
-			RebuildMesh(GetDynamicMesh(), VisualMesh);
+void UCSGBaseComponent::ApplyRebuildResult(FCSGRebuildResult& Result)
+{
+	CSG_SCOPE_CYCLE_COUNTER(STAT_CSGApplyResult);
 
-			RebuildMesh(CollisionMesh, CollisionMesh);
+	double CollisionSeconds = 0.0;
+	if (Result.bHasVisual)
+	{
+		//the slots of the area materials only change together with the mesh using them
+		AreaMaterials = PendingAreaMaterials;
+		SyncMaterials();
+
+		//subtracting nothing leaves the source mesh as it is, intersecting with nothing leaves nothing.
+		//fields and post-processing rebuild the surface even without areas, so the source is used directly
+		const bool bUncut = bDoReverseCSG && Result.AreaCount == 0;
+		if (bUncut)
+		{
+			GetDynamicMesh()->SetMesh(FetchVisualSource());
 		}
+		else
+		{
+			GetDynamicMesh()->SetMesh(MoveTemp(Result.VisualMesh));
+		}
+
+		OnVisualResultApplied(bUncut);
+	}
 
+	if (Result.bHasCollision)
+	{
+		//the cooked collision doesn't reference the mesh, it stays in the scratch mesh until the next collision update.
+		//copying into it keeps the allocations of the scratch mesh instead of swapping in fresh ones
+		UDynamicMesh* CollisionMesh = GetScratchMesh(ECSGScratchMesh::CollisionResult);
+		CollisionMesh->EditMesh([&Result](UE::Geometry::FDynamicMesh3& Mesh)
+		{
+			Mesh.Copy(Result.CollisionMesh);
+		});
+		UpdateScratchStats(CollisionMesh->GetMeshRef());
+
+		CSG_SCOPE_CYCLE_COUNTER(STAT_CSGCollision);
+		const double CollisionStart = FPlatformTime::Seconds();
 		UGeometryScriptLibrary_CollisionFunctions::SetDynamicMeshCollisionFromMesh(
 			CollisionMesh, this, CollisionOptions);
+		CollisionSeconds = FPlatformTime::Seconds() - CollisionStart;
+	}
+
+	UpdateRebuildStats(Result, CollisionSeconds);
+}
+
+void UCSGBaseComponent::UpdateRebuildStats(const FCSGRebuildResult& Result, double CollisionSeconds)
+{
+	if (!Result.bHasVisual && !Result.bHasCollision)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_CSGRebuilds);
+	INC_DWORD_STAT_BY(STAT_CSGInputTriangles, Result.InputTriangleCount);
+	INC_DWORD_STAT_BY(STAT_CSGOutputTriangles, Result.OutputTriangleCount);
+
+	const double Now = FPlatformTime::Seconds();
+	RecentRebuildTimes.Add(Now);
+	RecentRebuildTimes.RemoveAll([Now](double Time)
+	{
+		return Now - Time > 1.0;
+	});
+
+	++RebuildStats.RebuildCount;
+	RebuildStats.RebuildsPerSecond = RecentRebuildTimes.Num();
+	RebuildStats.LastEvaluationMs = Result.EvaluationSeconds * 1000.0;
+	RebuildStats.TotalEvaluationMs += RebuildStats.LastEvaluationMs;
+	if (Result.bHasCollision)
+	{
+		RebuildStats.LastCollisionMs = CollisionSeconds * 1000.0;
+	}
+	RebuildStats.InputTriangleCount = Result.InputTriangleCount;
+	RebuildStats.OutputTriangleCount = Result.OutputTriangleCount;
+}
+
+void UCSGBaseComponent::EvaluateCSG(const TArray<const UCSGAreaComponent*>& CandidateAreas,
+                                    FCSGRebuildResult& OutResult, TArray<UMaterialInterface*>& OutMaterials)
+{
+	//the scratch meshes, the collision proxy and the fetched flags belong to the scheduled rebuilds,
+	//so the sources are fetched into a mesh of their own
+	UDynamicMesh* Source = NewObject<UDynamicMesh>(GetTransientPackage());
+	GetVisualMesh(Source);
+	UE::Geometry::FDynamicMesh3 VisualSource = Source->GetMeshRef();
+	Source->Reset();
+	GetCollisionMesh(Source);
+	UE::Geometry::FDynamicMesh3 CollisionSource = Source->GetMeshRef();
+	Source->Reset();
+
+	const FBox WorldBounds = (GetMeshBounds(VisualSource) + GetMeshBounds(CollisionSource)).TransformBy(
+		GetComponentTransform());
+	const TArray<const UCSGAreaComponent*> Areas = CandidateAreas.FilterByPredicate(
+		[this, &WorldBounds](const UCSGAreaComponent* Area)
+		{
+			return IsAffectedBy(Area, WorldBounds);
+		});
+
+	TArray<UMaterialInterface*> EvaluatedAreaMaterials;
+	const FCSGFingerprint Fingerprint = MakeFingerprint(Areas, EvaluatedAreaMaterials);
+
+	//a one off evaluation mustn't leave anything behind in the caches the scheduled rebuilds start from
+	FCSGRebuildInput Input;
+	MakeRebuildInput(Fingerprint, Input, false);
+	Input.VisualMesh = MoveTemp(VisualSource);
+	Input.CollisionMesh = MoveTemp(CollisionSource);
+	if (CollisionProxyTriangleCount > 0)
+	{
+		CSG::Simplify(Input.CollisionMesh, CollisionProxyTriangleCount);
+	}
+
+	CSG::Evaluate(Input, OutResult);
+
+	OutMaterials.Append(Materials);
+	OutMaterials.Add(CSGMaterial);
+	OutMaterials.Append(EvaluatedAreaMaterials);
+}
+
+void UCSGBaseComponent::SetCSGBaked(bool bBaked, bool bEditorOnly)
+{
+	Modify();
+	bCSGBaked = bBaked;
+	bIsEditorOnly = bBaked && bEditorOnly;
+
+	//the collision is only switched off in BeginPlay, so clearing the flag gets the configured collision back
+	SetVisibility(!bBaked);
+}
+
+UDynamicMesh* UCSGBaseComponent::GetScratchMesh(ECSGScratchMesh Role)
+{
+	const int32 Index = static_cast<int32>(Role);
+	if (ScratchMeshes.Num() <= Index)
+	{
+		ScratchMeshes.SetNum(static_cast<int32>(ECSGScratchMesh::Count));
+	}
+
+	TObjectPtr<UDynamicMesh>& Mesh = ScratchMeshes[Index];
+	if (!Mesh)
+	{
+		Mesh = NewObject<UDynamicMesh>(this);
+		++ScratchStats.MeshCount;
+		INC_DWORD_STAT(STAT_CSGScratchMeshes);
+	}
+
+	return Mesh;
+}
+
+const UE::Geometry::FDynamicMesh3& UCSGBaseComponent::FetchVisualSource()
+{
+	UDynamicMesh* Mesh = GetScratchMesh(ECSGScratchMesh::VisualSource);
+	if (!bVisualSourceFetched)
+	{
+		//GetVisualMesh expects an empty mesh, the previous source only gets dropped once it has changed
+		Mesh->Reset();
+		GetVisualMesh(Mesh);
+		UpdateScratchStats(Mesh->GetMeshRef());
+		bVisualSourceFetched = true;
+	}
+	return Mesh->GetMeshRef();
+}
+
+const UE::Geometry::FDynamicMesh3& UCSGBaseComponent::FetchCollisionSource()
+{
+	UDynamicMesh* Mesh = GetScratchMesh(ECSGScratchMesh::CollisionSource);
+	if (!bCollisionSourceFetched)
+	{
+		Mesh->Reset();
+		GetCollisionMesh(Mesh);
+		UpdateScratchStats(Mesh->GetMeshRef());
+		bCollisionSourceFetched = true;
+	}
+	return Mesh->GetMeshRef();
+}
+
+void UCSGBaseComponent::UpdateScratchStats(const UE::Geometry::FDynamicMesh3& Mesh)
+{
+	ScratchStats.PeakVertexCount = FMath::Max(ScratchStats.PeakVertexCount, Mesh.MaxVertexID());
+	ScratchStats.PeakTriangleCount = FMath::Max(ScratchStats.PeakTriangleCount, Mesh.MaxTriangleID());
+}
+
+bool UCSGBaseComponent::IsCollisionUpdateDue(double Now) const
+{
+	switch (CollisionUpdatePolicy)
+	{
+	case ECSGCollisionUpdatePolicy::RateLimited:
+		return Now - LastCollisionUpdateTime >= CollisionUpdateInterval;
+	case ECSGCollisionUpdatePolicy::OnSettle:
+		return Now - LastAreaChangeTime >= CollisionSettleTime;
+	default:
+		return true;
+	}
+}
+
+void UCSGBaseComponent::ProcessRebuild()
+{
+	FCSGRebuildInput Input;
+	if (BeginRebuild(Input))
+	{
+		FCSGRebuildResult Result;
+		CSG::Evaluate(Input, Result);
+		ApplyRebuildResult(Result);
+	}
+}
+
+bool UCSGBaseComponent::BeginRebuild(FCSGRebuildInput& OutInput)
+{
+	if (PendingRebuild.IsValid())
+	{
+		//requests made while the job is running are coalesced into a single rebuild once it finished
+		if (!PendingRebuild.IsReady())
+		{
+			RequestDeferredRebuild();
+			return false;
+		}
+
+		PendingRebuild.Reset();
+		ApplyRebuildResult(*PendingResult);
+		PendingResult.Reset();
+	}
+
+	TArray<const UCSGAreaComponent*> Areas;
+	GatherAreas(Areas);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	TArray<UMaterialInterface*> NewAreaMaterials;
+	FCSGFingerprint Fingerprint = MakeFingerprint(Areas, NewAreaMaterials);
+
+	if (RestoredResult)
+	{
+		//the restored result stands in for evaluating the current areas
+		RestoredResult->AreaCount = Fingerprint.Areas.Num();
+		PendingAreaMaterials = NewAreaMaterials;
+		ApplyRebuildResult(*RestoredResult);
+		bCollisionStale = !RestoredResult->bHasCollision;
+		RestoredResult.Reset();
+
+		if (bIncrementalCSG && bDoReverseCSG)
+		{
+			VisualIncremental = MakeShared<FCSGIncrementalCache, ESPMode::ThreadSafe>();
+			VisualIncremental->Result = GetDynamicMesh()->GetMeshRef();
+			VisualIncremental->AppliedAreas = Fingerprint.Areas;
+			VisualIncremental->ComponentTransform = Fingerprint.ComponentTransform;
+			VisualIncremental->bValid = true;
+
+			//the collision mesh has to catch up from the source once, the visual one doesn't
+			CollisionIncremental = MakeShared<FCSGIncrementalCache, ESPMode::ThreadSafe>();
+		}
+
+		LastFingerprint = MoveTemp(Fingerprint);
+		LastCollisionUpdateTime = Now;
+		if (bCollisionStale)
+		{
+			RequestDeferredRebuild();
+		}
+		return false;
+	}
+	const bool bFirstBuild = !LastFingerprint.IsSet();
+	const bool bChanged = bFirstBuild || !LastFingerprint->VisualEquals(Fingerprint);
+	const bool bCollisionChanged = bFirstBuild || !LastFingerprint->CollisionEquals(Fingerprint);
+	if (bCollisionChanged)
+	{
+		LastAreaChangeTime = Now;
+	}
+
+	//areas only on visual layers leave the collision as it is
+	const bool bUpdateCollision = (bCollisionChanged || bCollisionStale) &&
+		(bFirstBuild || IsCollisionUpdateDue(Now));
+	if (!bChanged && !bUpdateCollision)
+	{
+		//nothing moved since the last rebuild, only a deferred collision update can still be waiting
+		if (bCollisionStale)
+		{
+			RequestDeferredRebuild();
+		}
+		return false;
+	}
+
+	OutInput.bEvaluateVisual = bChanged;
+	OutInput.bEvaluateCollision = bUpdateCollision;
+	if (bChanged)
+	{
+		PendingAreaMaterials = NewAreaMaterials;
+	}
+	MakeRebuildInput(Fingerprint, OutInput);
+	LastFingerprint = MoveTemp(Fingerprint);
+
+	if (bUpdateCollision)
+	{
+		LastCollisionUpdateTime = Now;
+		bCollisionStale = false;
+	}
+	else if (bCollisionChanged || bCollisionStale)
+	{
+		//wait until the collision is allowed to catch up with the visual mesh
+		bCollisionStale = true;
+		RequestDeferredRebuild();
+	}
+
+	if (bAsyncRebuild)
+	{
+		PendingResult = MakeShared<FCSGRebuildResult, ESPMode::ThreadSafe>();
+		PendingRebuild = Async(EAsyncExecution::ThreadPool,
+		                       [Input = MoveTemp(OutInput), Result = PendingResult]() mutable
+		                       {
+			                       CSG::Evaluate(Input, *Result);
+		                       });
+
+		//the result is picked up once the job finished
+		RequestDeferredRebuild();
+		return false;
 	}
 
-	MeshPool->ReturnAllMeshes();
+	return true;
 }
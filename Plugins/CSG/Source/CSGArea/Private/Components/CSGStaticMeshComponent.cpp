@@ -3,15 +3,14 @@
 
 #include "Components/CSGStaticMeshComponent.h"
 
-#include "GeometryScript/MeshAssetFunctions.h"
+#include "CSGInstanceSubsystem.h"
+#include "CSGStaticMeshCache.h"
+#include "UDynamicMesh.h"
+#include "Engine/StaticMesh.h"
 
 // Sets default values for this component's properties
 UCSGStaticMeshComponent::UCSGStaticMeshComponent()
 {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
-
 #if WITH_EDITORONLY_DATA
 	if (!IsRunningGame())
 	{
@@ -39,22 +38,126 @@ void UCSGStaticMeshComponent::BeginPlay()
 	}
 #endif
 
-	// ...
+#if WITH_EDITOR
+	//the cached conversion gets dropped when the asset is rebuilt, the CSG has to pick up the new version
+	if (Mesh)
+	{
+		Mesh->OnPostMeshBuild().AddUObject(this, &UCSGStaticMeshComponent::OnMeshBuilt);
+	}
+#endif
+}
+
+void UCSGStaticMeshComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	SetInstanced(false);
+
+#if WITH_EDITOR
+	if (Mesh)
+	{
+		Mesh->OnPostMeshBuild().RemoveAll(this);
+	}
+#endif
+
+	Super::EndPlay(EndPlayReason);
+}
+
+FBox UCSGStaticMeshComponent::GetLocalSourceBounds() const
+{
+	//the bounds of the asset are known without converting it, so they are available in the editor too
+	if (!Mesh)
+	{
+		return Super::GetLocalSourceBounds();
+	}
+	return Mesh->GetBoundingBox();
+}
+
+bool UCSGStaticMeshComponent::WasCSGRecentlyRendered(float Tolerance) const
+{
+	return bInstanced || Super::WasCSGRecentlyRendered(Tolerance);
+}
+
+void UCSGStaticMeshComponent::OnVisualResultApplied(bool bMatchesSource)
+{
+	Super::OnVisualResultApplied(bMatchesSource);
+
+	//the cut result is already in the dynamic mesh, so switching over in the same frame doesn't pop
+	SetInstanced(bMatchesSource && bInstanceWhenUncut && Mesh && IsVisible());
+}
+
+void UCSGStaticMeshComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
+
+	if (bInstanced)
+	{
+		if (UCSGInstanceSubsystem* Instances = GetWorld()->GetSubsystem<UCSGInstanceSubsystem>())
+		{
+			Instances->UpdateInstance(this);
+		}
+	}
+}
+
+FPrimitiveSceneProxy* UCSGStaticMeshComponent::CreateSceneProxy()
+{
+	return bInstanced ? nullptr : Super::CreateSceneProxy();
+}
+
+void UCSGStaticMeshComponent::SetInstanced(bool bNewInstanced)
+{
+	if (bInstanced == bNewInstanced)
+	{
+		return;
+	}
+
+	UCSGInstanceSubsystem* Instances = GetWorld()->GetSubsystem<UCSGInstanceSubsystem>();
+	if (!Instances)
+	{
+		return;
+	}
+
+	bInstanced = bNewInstanced;
+	if (bInstanced)
+	{
+		//without overrides the instance draws the materials of the mesh, components are only batched by what they draw
+		TArray<TObjectPtr<UMaterialInterface>> EffectiveMaterials;
+		const TArray<FStaticMaterial>& StaticMaterials = Mesh->GetStaticMaterials();
+		for (int32 i = 0; i < StaticMaterials.Num(); ++i)
+		{
+			UMaterialInterface* Override = Materials.IsValidIndex(i) ? Materials[i].Get() : nullptr;
+			EffectiveMaterials.Add(Override ? Override : StaticMaterials[i].MaterialInterface.Get());
+		}
+		Instances->AddInstance(this, Mesh, EffectiveMaterials);
+	}
+	else
+	{
+		Instances->RemoveInstance(this);
+	}
+
+	MarkRenderStateDirty();
 }
 
 void UCSGStaticMeshComponent::GetVisualMesh_Implementation(UDynamicMesh* OutMesh)
 {
-	EGeometryScriptOutcomePins Result;
-	UGeometryScriptDebug* Debug = NewObject<UGeometryScriptDebug>();
-	UGeometryScriptLibrary_StaticMeshFunctions::CopyMeshFromStaticMesh(Mesh, OutMesh, {}, {}, Result, Debug);
+	if (const auto Converted = FCSGStaticMeshCache::Get().FindOrConvert(Mesh))
+	{
+		OutMesh->SetMesh(*Converted);
+	}
 }
 
 void UCSGStaticMeshComponent::GetCollisionMesh_Implementation(UDynamicMesh* OutMesh)
 {
-	EGeometryScriptOutcomePins Result;
-	UGeometryScriptDebug* Debug = NewObject<UGeometryScriptDebug>();
-	UGeometryScriptLibrary_StaticMeshFunctions::CopyMeshFromStaticMesh(Mesh, OutMesh, {}, {}, Result, Debug);
+	if (const auto Converted = FCSGStaticMeshCache::Get().FindOrConvert(Mesh))
+	{
+		OutMesh->SetMesh(*Converted);
+	}
+}
+
+#if WITH_EDITOR
+void UCSGStaticMeshComponent::OnMeshBuilt(UStaticMesh* BuiltMesh)
+{
+	MarkCSGDirty();
 }
+#endif
 
 void UCSGStaticMeshComponent::OnRegister()
 {
@@ -79,11 +182,3 @@ void UCSGStaticMeshComponent::OnComponentDestroyed(bool bDestroyingHierarchy)
 #endif
 }
 
-// Called every frame
-void UCSGStaticMeshComponent::TickComponent(float DeltaTime, ELevelTick TickType,
-                                            FActorComponentTickFunction* ThisTickFunction)
-{
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-
-	// ...
-}
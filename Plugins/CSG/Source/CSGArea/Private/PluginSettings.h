@@ -21,10 +21,38 @@ public:
 	{
 	};
 
-	/// @brief Collision channel to use for detecting CSG collisions
-	UPROPERTY(Config, EditAnywhere, Category = "Collision")
-	TEnumAsByte<ECollisionChannel> CollisionChannel = ECC_WorldStatic;
-
 	UPROPERTY(Config, EditAnywhere, Category = "Preview")
 	TSoftObjectPtr<UMaterialInterface> DefaultAreaMaterial;
+
+	/// @brief Edge length adaptive cutters aim for, larger areas get more steps
+	UPROPERTY(Config, EditAnywhere, Category = "Cutter", meta = (ClampMin = 0.1, Units = "Centimeters"))
+	float CutterEdgeLength = 10.0f;
+
+	/// @brief Steps an adaptive cutter gets when it covers the whole screen, smaller areas on screen get fewer
+	UPROPERTY(Config, EditAnywhere, Category = "Cutter", meta = (ClampMin = 2))
+	int32 CutterFullScreenResolution = 24;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Cutter", meta = (ClampMin = 2, ClampMax = 64))
+	int32 MinCutterResolution = 3;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Cutter", meta = (ClampMin = 2, ClampMax = 64))
+	int32 MaxCutterResolution = 24;
+
+	/// @brief Time CSG rebuilds may take on the game thread per frame, components over budget wait for the next frame.
+	/// At least one component is rebuilt every frame, 0 rebuilds every queued component right away
+	UPROPERTY(Config, EditAnywhere, Category = "Scheduling", meta = (ClampMin = 0, Units = "Milliseconds"))
+	float RebuildBudgetMs = 4.0f;
+
+	/// @brief Distance multiplier for components that weren't rendered recently, higher values delay them further
+	UPROPERTY(Config, EditAnywhere, Category = "Scheduling", meta = (ClampMin = 1))
+	float HiddenRebuildPriorityScale = 4.0f;
+
+	/// @brief Whether queued components get evaluated in batches across the worker threads,
+	/// only snapshotting the components and applying the results stays on the game thread
+	UPROPERTY(Config, EditAnywhere, Category = "Scheduling")
+	bool bParallelRebuild = true;
+
+	/// @brief Cell size of the grid areas and CSG components are indexed in, around the size of a typical CSG mesh
+	UPROPERTY(Config, EditAnywhere, Category = "Scheduling", meta = (ClampMin = 1, Units = "Centimeters"))
+	float AreaGridCellSize = 500.0f;
 };
@@ -0,0 +1,48 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CSGSpatialGrid.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CSGAreaSubsystem.generated.h"
+
+class UCSGAreaComponent;
+class UCSGBaseComponent;
+
+/// @brief Spatial index of the areas and CSG components in a world,
+/// finds the areas affecting a component without relying on physics overlaps
+UCLASS()
+class CSGAREA_API UCSGAreaSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	void RegisterArea(UCSGAreaComponent* Area);
+	void UnregisterArea(UCSGAreaComponent* Area);
+
+	/// @brief Adds the component or moves it to its current source bounds
+	void UpdateCSGComponent(UCSGBaseComponent* Component);
+	void UnregisterCSGComponent(UCSGBaseComponent* Component);
+
+	/// @brief Collects the areas whose bounds intersect the box
+	void QueryAreas(const FBox& Bounds, TArray<UCSGAreaComponent*>& OutAreas) const;
+
+protected:
+	void OnAreaTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags,
+	                            ETeleportType Teleport);
+	void OnAreaChanged(UCSGAreaComponent* Area);
+
+	/// @brief Moves the area to its current bounds, rebuilding the components around its old and new bounds
+	void UpdateArea(UCSGAreaComponent* Area);
+
+	/// @brief Requests a rebuild of every component intersecting the box that accepts areas on the layers
+	void NotifyComponents(const FBox& Bounds, int32 Layers) const;
+
+	static FBox GetAreaBounds(const UCSGAreaComponent* Area);
+
+	TCSGSpatialGrid<UCSGAreaComponent> Areas;
+	TCSGSpatialGrid<UCSGBaseComponent> Components;
+};
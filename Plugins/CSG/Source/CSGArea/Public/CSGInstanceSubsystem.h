@@ -0,0 +1,73 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CSGInstanceSubsystem.generated.h"
+
+class UCSGStaticMeshComponent;
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+
+/// @brief Instances of one mesh and material combination
+USTRUCT()
+struct FCSGInstanceBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UStaticMesh> Mesh;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UMaterialInterface>> Materials;
+
+	UPROPERTY()
+	TObjectPtr<UInstancedStaticMeshComponent> Instances;
+
+	/// @brief Component of every instance, in instance order
+	TArray<UCSGStaticMeshComponent*> Components;
+};
+
+/// @brief Renders CSG components no area touches through shared instanced static meshes,
+/// so uncut copies of a mesh cost the same amount of draw calls as plain static meshes
+///
+/// The components keep their own collision, the instances are only drawn
+UCLASS()
+class CSGAREA_API UCSGInstanceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/// Starts drawing the component's mesh as an instance, at the current transform of the component
+	///
+	/// @param Materials Material of every slot of the mesh, with the overrides of the component applied
+	void AddInstance(UCSGStaticMeshComponent* Component, UStaticMesh* Mesh,
+	                 const TArray<TObjectPtr<UMaterialInterface>>& Materials);
+
+	void RemoveInstance(UCSGStaticMeshComponent* Component);
+
+	/// @brief Moves the instance of the component to the current transform of the component
+	void UpdateInstance(UCSGStaticMeshComponent* Component);
+
+	int32 GetBatchCount() const
+	{
+		return Batches.Num();
+	}
+
+	virtual void Deinitialize() override;
+
+protected:
+	int32 FindOrAddBatch(UStaticMesh* Mesh, const TArray<TObjectPtr<UMaterialInterface>>& Materials);
+
+	UPROPERTY()
+	TArray<FCSGInstanceBatch> Batches;
+
+	/// @brief Batch each instanced component is in
+	TMap<UCSGStaticMeshComponent*, int32> ComponentBatches;
+
+	/// @brief Transient actor owning the instanced static mesh components
+	UPROPERTY()
+	TObjectPtr<AActor> InstanceActor;
+};
@@ -0,0 +1,350 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BoxTypes.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "UObject/ObjectKey.h"
+#include "CSGMeshOperations.generated.h"
+
+/// @brief Shape an area cuts with
+UENUM(BlueprintType)
+enum class ECSGAreaShape : uint8
+{
+	Sphere,
+	Box,
+	Capsule,
+	/// @brief Convex hull of a static mesh
+	Convex,
+	/// @brief A static mesh as is, it should be closed
+	StaticMesh
+};
+
+/// @brief Layers areas can be on, CSG components only evaluate the areas on the layers they accept
+UENUM(BlueprintType, meta = (Bitflags))
+enum class ECSGLayer : uint8
+{
+	Layer1,
+	Layer2,
+	Layer3,
+	Layer4,
+	Layer5,
+	Layer6,
+	Layer7,
+	Layer8
+};
+
+/// @brief State of a single area at the time of a rebuild
+struct FCSGAreaSnapshot
+{
+	FObjectKey Component;
+	FTransform Transform;
+
+	/// @brief Radius of a sphere around the area containing the whole shape, in the local space of the area
+	float Radius = 0.0f;
+
+	ECSGAreaShape Shape = ECSGAreaShape::Sphere;
+
+	/// @brief Half extents of a box, for a capsule X is the radius and Z the half height including the caps
+	FVector Extent = FVector::ZeroVector;
+
+	/// @brief Material ID of the faces this area creates, the cached cutter already carries it on every triangle
+	int32 MaterialID = 0;
+
+	/// @brief Cutter mesh cached by the area in its local space, MakeAreaMesh generates one when this isn't set
+	TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> Cutter;
+
+	bool Equals(const FCSGAreaSnapshot& Other) const;
+};
+
+/// @brief Closed piece of a source mesh together with the cached result of cutting it
+struct FCSGChunk
+{
+	UE::Geometry::FDynamicMesh3 Source;
+	UE::Geometry::FAxisAlignedBox3d Bounds;
+
+	/// @brief Areas touching the chunk when Result was built
+	TArray<FCSGAreaSnapshot> AppliedAreas;
+	UE::Geometry::FDynamicMesh3 Result;
+	bool bHasResult = false;
+};
+
+/// @brief Source mesh split into chunks, kept between rebuilds so chunks no area changed around can reuse their result
+struct FCSGChunkCache
+{
+	TArray<FCSGChunk> Chunks;
+	bool bBuilt = false;
+
+	/// @brief State the chunk results were built with, any change invalidates all of them
+	FTransform ComponentTransform;
+	bool bReverse = false;
+};
+
+/// @brief Result of the last subtractive rebuild, so areas added since can be subtracted from it on their own
+struct FCSGIncrementalCache
+{
+	UE::Geometry::FDynamicMesh3 Result;
+
+	/// @brief Areas already subtracted from Result
+	TArray<FCSGAreaSnapshot> AppliedAreas;
+
+	FTransform ComponentTransform;
+	bool bValid = false;
+};
+
+/// @brief Clean up applied to the output of the CSG, disabled by default
+struct FCSGPostProcessSettings
+{
+	bool bEnabled = false;
+
+	/// @brief Open edges closer than this get welded, and triangles thinner than this get collapsed or flipped
+	double WeldTolerance = 0.01;
+
+	/// @brief The mesh gets simplified down to this amount of triangles, 0 disables the simplification
+	int32 TriangleBudget = 0;
+
+	/// @brief Rings of triangles around the cut faces that may be simplified, the rest of the mesh is kept as is
+	int32 CutRegionRings = 2;
+};
+
+/// @brief Sparse signed distance field of a source mesh used by CSG::EvaluateSdf, created with CSG::MakeSdfCache
+struct FCSGSdfCache;
+
+/// @brief Everything needed to evaluate the CSG of a component,
+/// this is a copy of the component's state so it can be evaluated away from the game thread
+struct FCSGRebuildInput
+{
+	/// @brief Source meshes, left empty when the chunks or the field of the mesh have already been built
+	UE::Geometry::FDynamicMesh3 VisualMesh;
+	UE::Geometry::FDynamicMesh3 CollisionMesh;
+
+	FTransform ComponentTransform;
+
+	/// @brief Areas cutting the visual mesh
+	TArray<FCSGAreaSnapshot> Areas;
+
+	/// @brief Areas cutting the collision mesh, only the ones on layers the collision accepts
+	TArray<FCSGAreaSnapshot> CollisionAreas;
+
+	/// @brief Lowest material ID of the faces created by the areas, areas with their own material use higher IDs
+	int32 CSGMaterialID = 0;
+
+	bool bReverse = false;
+
+	/// @brief Whether areas should be cut with CSG::TrySphereCut before falling back to a mesh boolean
+	bool bAnalyticSphereCut = true;
+
+	/// @brief Whether areas should be cut with CSG::TryConvexCut before falling back to a mesh boolean
+	bool bAnalyticConvexCut = true;
+
+	/// @brief Which of the meshes have to be rebuilt, the other one is left empty
+	bool bEvaluateVisual = true;
+	bool bEvaluateCollision = true;
+
+	FCSGPostProcessSettings PostProcess;
+
+	/// @brief Whether subtractive rebuilds may start from the previous result when areas only got added,
+	/// ignored when chunking is enabled
+	bool bIncremental = false;
+
+	/// @brief Previous results, only used when bIncremental is set
+	TSharedPtr<FCSGIncrementalCache, ESPMode::ThreadSafe> VisualIncremental;
+	TSharedPtr<FCSGIncrementalCache, ESPMode::ThreadSafe> CollisionIncremental;
+
+	/// @brief Signed distance fields of the source meshes, when set the areas are evaluated with CSG::EvaluateSdf
+	/// instead of mesh booleans, this takes precedence over chunking
+	TSharedPtr<FCSGSdfCache, ESPMode::ThreadSafe> VisualSdf;
+	TSharedPtr<FCSGSdfCache, ESPMode::ThreadSafe> CollisionSdf;
+
+	/// @brief Maximum amount of triangles per chunk, 0 disables chunking
+	int32 MaxChunkTriangles = 0;
+
+	/// @brief Chunks of the source meshes, only used when chunking is enabled,
+	/// the source meshes are ignored once the chunks have been built
+	TSharedPtr<FCSGChunkCache, ESPMode::ThreadSafe> VisualChunks;
+	TSharedPtr<FCSGChunkCache, ESPMode::ThreadSafe> CollisionChunks;
+};
+
+/// @brief Meshes produced by a rebuild, in the local space of the component
+struct FCSGRebuildResult
+{
+	UE::Geometry::FDynamicMesh3 VisualMesh;
+	UE::Geometry::FDynamicMesh3 CollisionMesh;
+
+	bool bHasVisual = false;
+	bool bHasCollision = false;
+
+	/// @brief Amount of areas the result was evaluated with
+	int32 AreaCount = 0;
+
+	/// @brief Triangles of the meshes going into and coming out of the evaluation, for profiling
+	int32 InputTriangleCount = 0;
+	int32 OutputTriangleCount = 0;
+
+	/// @brief Wall time spent in CSG::Evaluate
+	double EvaluationSeconds = 0.0;
+};
+
+/// @brief Thread safe mesh operations used by the CSG components,
+/// these only touch the meshes passed in, so they can run on any thread
+namespace CSG
+{
+	/// @brief Boolean operation to perform, matching the Geometry Script boolean operations
+	enum class EBooleanOp : uint8
+	{
+		Union,
+		Intersection,
+		Subtract
+	};
+
+	/// @brief Steps along each edge of the sphere cutter when the area doesn't specify any
+	constexpr int32 DefaultSphereSteps = 6;
+
+	/// Generates a sphere cutter around the origin
+	///
+	/// @param Radius Radius of the sphere
+	/// @param Steps Steps along each edge of the box the sphere gets generated from
+	/// @param MaterialID Material ID assigned to every triangle of the mesh
+	/// @return Sphere mesh in local space
+	CSGAREA_API UE::Geometry::FDynamicMesh3 MakeSphereCutter(double Radius, int32 Steps, int32 MaterialID);
+
+	/// @brief Generates a box cutter centered on the origin
+	CSGAREA_API UE::Geometry::FDynamicMesh3 MakeBoxCutter(const FVector& Extent, int32 MaterialID);
+
+	/// Generates a capsule cutter centered on the origin, along the Z axis
+	///
+	/// @param Radius Radius of the capsule
+	/// @param HalfHeight Half height of the capsule including the caps
+	/// @param Steps Steps along each cap, the circle gets four times as many
+	/// @param MaterialID Material ID assigned to every triangle of the mesh
+	CSGAREA_API UE::Geometry::FDynamicMesh3 MakeCapsuleCutter(double Radius, double HalfHeight, int32 Steps,
+	                                                         int32 MaterialID);
+
+	/// @brief Generates a cutter from the convex hull of the vertices of Source
+	CSGAREA_API UE::Geometry::FDynamicMesh3 MakeConvexCutter(const UE::Geometry::FDynamicMesh3& Source,
+	                                                        int32 MaterialID);
+
+	/// @brief Sets the material ID of every triangle, enabling the attribute when the mesh doesn't have it yet
+	CSGAREA_API void AssignMaterialID(UE::Geometry::FDynamicMesh3& Mesh, int32 MaterialID);
+
+	/// Builds the mesh used to cut with a single area, copying the cached cutter of the area when it has one
+	///
+	/// @param Area The area to build the mesh for, a generated mesh uses the material ID of the area
+	/// @return Sphere mesh in world space
+	CSGAREA_API UE::Geometry::FDynamicMesh3 MakeAreaMesh(const FCSGAreaSnapshot& Area);
+
+	/// Applies a boolean operation to TargetMesh,
+	/// behaves the same as UGeometryScriptLibrary_MeshBooleanFunctions::ApplyMeshBoolean with holes filled
+	/// and the output simplified
+	///
+	/// @param TargetMesh Mesh to modify, the result is stored in the local space of TargetTransform
+	/// @param TargetTransform Transform of the target mesh
+	/// @param ToolMesh Mesh to apply to the target
+	/// @param ToolTransform Transform of the tool mesh
+	/// @param Operation Boolean operation to perform
+	CSGAREA_API void ApplyBoolean(UE::Geometry::FDynamicMesh3& TargetMesh, const FTransform& TargetTransform,
+	                              const UE::Geometry::FDynamicMesh3& ToolMesh, const FTransform& ToolTransform,
+	                              EBooleanOp Operation);
+
+	/// Cuts the mesh with the exact sphere of an area instead of a tessellated one,
+	/// only the triangles crossing the sphere get split and the opening is closed with a cap following the sphere
+	///
+	/// @param Mesh Mesh to cut, in the local space of ComponentTransform
+	/// @param ComponentTransform Transform of the mesh
+	/// @param Area Area to cut with
+	/// @param Operation Either Intersection or Subtract
+	/// @param MaterialID Material ID assigned to the cap
+	/// @param OutMesh Output mesh in the local space of ComponentTransform, only valid when this returns true
+	/// @return False when the configuration isn't supported, ApplyBoolean should be used instead
+	CSGAREA_API bool TrySphereCut(const UE::Geometry::FDynamicMesh3& Mesh, const FTransform& ComponentTransform,
+	                              const FCSGAreaSnapshot& Area, EBooleanOp Operation, int32 MaterialID,
+	                              UE::Geometry::FDynamicMesh3& OutMesh);
+
+	/// Intersects the mesh with a box or convex area by cutting it with every face plane of the cutter,
+	/// which is exact and much cheaper than a boolean for convex shapes with few faces
+	///
+	/// @param Mesh Closed mesh to cut, in the local space of ComponentTransform
+	/// @param ComponentTransform Transform of the mesh
+	/// @param Area Area to cut with, needs a cached cutter
+	/// @param Operation Only Intersection is supported, the result of subtracting isn't convex
+	/// @param MaterialID Material ID assigned to the faces closing the cuts
+	/// @param OutMesh Output mesh in the local space of ComponentTransform, only valid when this returns true
+	/// @return False when the configuration isn't supported, ApplyBoolean should be used instead
+	CSGAREA_API bool TryConvexCut(const UE::Geometry::FDynamicMesh3& Mesh, const FTransform& ComponentTransform,
+	                              const FCSGAreaSnapshot& Area, EBooleanOp Operation, int32 MaterialID,
+	                              UE::Geometry::FDynamicMesh3& OutMesh);
+
+	/// @brief How the shape of an area relates to the bounds of a mesh
+	enum class EAreaCoverage : uint8
+	{
+		/// @brief The area doesn't touch the bounds
+		Disjoint,
+		/// @brief The area might cross the surface of the mesh
+		Partial,
+		/// @brief The area contains the bounds entirely
+		Contains
+	};
+
+	/// Tests the shape of an area against bounds analytically, the test is conservative so Partial is returned
+	/// when it can't tell
+	///
+	/// @param Bounds Bounds in the local space of ComponentTransform
+	/// @param ComponentTransform Transform of the bounds
+	/// @param Area Area to test
+	CSGAREA_API EAreaCoverage ClassifyBounds(const UE::Geometry::FAxisAlignedBox3d& Bounds,
+	                                         const FTransform& ComponentTransform, const FCSGAreaSnapshot& Area);
+
+	/// Reduces the mesh to at most the given amount of triangles while preserving its volume,
+	/// meant for building collision proxies
+	CSGAREA_API void Simplify(UE::Geometry::FDynamicMesh3& Mesh, int32 TriangleCount);
+
+	/// Welds open seams, removes slivers and simplifies the region around the cut faces to fit the triangle budget
+	///
+	/// @param Mesh Mesh to clean up
+	/// @param Settings What to clean up
+	/// @param TriangleBudget Amount of triangles to simplify to, 0 skips the simplification
+	/// @param CutMaterialID Lowest material ID of the cut faces, used to find the region the simplification may touch
+	CSGAREA_API void PostProcess(UE::Geometry::FDynamicMesh3& Mesh, const FCSGPostProcessSettings& Settings,
+	                             int32 TriangleBudget, int32 CutMaterialID);
+
+	/// @brief Writes the mesh compressed into OutData, the mesh isn't modified
+	CSGAREA_API void SaveMesh(const UE::Geometry::FDynamicMesh3& Mesh, TArray<uint8>& OutData);
+
+	/// @brief Reads a mesh written by SaveMesh, returns false when the data is empty
+	CSGAREA_API bool LoadMesh(const TArray<uint8>& Data, UE::Geometry::FDynamicMesh3& OutMesh);
+
+	/// Returns whether both lists contain the same areas in the same state, the lists should be sorted the same way
+	CSGAREA_API bool AreasEqual(const TArray<FCSGAreaSnapshot>& A, const TArray<FCSGAreaSnapshot>& B);
+
+	/// Splits a mesh into closed chunks by recursively cutting it in half and filling the cut,
+	/// so every chunk can be cut by areas on its own. The faces filling the cuts are tagged by their material ID,
+	/// the evaluation removes them again and welds the chunks together along the seams
+	///
+	/// @param Mesh Mesh to split
+	/// @param MaxChunkTriangles Parts with more triangles than this get split further
+	/// @param OutChunks Output chunks, without results
+	CSGAREA_API void SplitIntoChunks(const UE::Geometry::FDynamicMesh3& Mesh, int32 MaxChunkTriangles,
+	                                 TArray<FCSGChunk>& OutChunks);
+
+	/// @brief Creates an empty signed distance field, it gets built from the source mesh by the first evaluation
+	CSGAREA_API TSharedPtr<FCSGSdfCache, ESPMode::ThreadSafe> MakeSdfCache(float VoxelSize);
+
+	/// @brief Whether the field has been built from a source mesh, later evaluations don't need the source anymore
+	CSGAREA_API bool IsSdfBuilt(const FCSGSdfCache& Cache);
+
+	/// Evaluates the areas on the signed distance field of the mesh instead of with mesh booleans,
+	/// only the bricks of the field touched by an area that changed since the last evaluation get meshed again
+	///
+	/// @param Mesh Source mesh the first time the cache is used, ignored afterwards. Replaced by the result,
+	/// which keeps the material IDs but loses the UVs of the source
+	/// @param Cache Field to evaluate on, mustn't be used by two evaluations at the same time
+	/// @param Input Areas and settings to evaluate with
+	CSGAREA_API void EvaluateSdf(UE::Geometry::FDynamicMesh3& Mesh, FCSGSdfCache& Cache, const FCSGRebuildInput& Input);
+
+	/// Evaluates the CSG for both the visual and the collision mesh
+	///
+	/// @param Input Snapshot of the component, the source meshes are consumed
+	/// @param OutResult Output meshes in the local space of the component
+	CSGAREA_API void Evaluate(FCSGRebuildInput& Input, FCSGRebuildResult& OutResult);
+}
@@ -0,0 +1,81 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CSGRebuildSubsystem.generated.h"
+
+class UCSGBaseComponent;
+
+/// @brief Queues CSG components that need a rebuild and processes them within a time budget every frame,
+/// components closest to a player and visible go first, the rest are spread over the next frames
+UCLASS()
+class CSGAREA_API UCSGRebuildSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/// @brief Queues the component for a rebuild, requests for a component that's already queued are merged
+	void Enqueue(UCSGBaseComponent* Component);
+
+	/// @brief Parks the component until its background rebuild finished or its collision is due,
+	/// it's only queued again then, without being fingerprinted in between
+	void EnqueueWhenDue(UCSGBaseComponent* Component);
+
+	void Dequeue(UCSGBaseComponent* Component);
+
+	int32 GetQueueLength() const
+	{
+		return Queue.Num();
+	}
+
+	int32 GetWaitingCount() const
+	{
+		return Waiting.Num();
+	}
+
+	/// @brief Overrides RebuildBudgetMs of the plugin settings for this world, negative values use the settings again
+	void SetRebuildBudgetOverride(float BudgetMs)
+	{
+		BudgetMsOverride = BudgetMs;
+	}
+
+	/// @brief Keeps the saved state of a component that gets streamed out, until it's streamed in again
+	void StoreStreamedState(const UCSGBaseComponent* Component, TArray<uint8>&& State);
+
+	/// @brief Removes and returns the state stored for the component, returns false when there is none
+	bool TakeStreamedState(const UCSGBaseComponent* Component, TArray<uint8>& OutState);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/// @brief Drops the states of levels that won't stream in again because their streaming level is gone
+	void OnLevelRemovedFromWorld(ULevel* Level, UWorld* World);
+
+	/// @brief Expected wall time of evaluating the component, negative when nothing has been measured yet
+	double GetEstimatedEvaluationSeconds(const UCSGBaseComponent* Component) const;
+
+	/// @brief Lower values get processed first
+	double GetPriority(const UCSGBaseComponent* Component, int32 FramesWaiting, const TArray<FVector>& Viewpoints) const;
+
+	/// @brief Queued components along with the amount of frames they have been waiting
+	TMap<TWeakObjectPtr<UCSGBaseComponent>, int32> Queue;
+
+	/// @brief Components parked by EnqueueWhenDue
+	TSet<TWeakObjectPtr<UCSGBaseComponent>> Waiting;
+
+	/// @brief Running average of the evaluation times, estimates components that haven't been rebuilt yet
+	double AverageEvaluationSeconds = -1.0;
+
+	float BudgetMsOverride = -1.0f;
+
+	/// @brief States of streamed out components by level package and path name,
+	/// which stays the same when the level streams in again
+	TMap<FName, TMap<FString, TArray<uint8>>> StreamedStates;
+
+	FDelegateHandle LevelRemovedHandle;
+};
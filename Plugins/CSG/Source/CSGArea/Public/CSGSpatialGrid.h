@@ -0,0 +1,158 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// @brief Uniform hash grid of items by their world bounds, answers which items intersect a box
+///
+/// Items aren't owned by the grid, they have to be removed before they get destroyed
+template <typename ItemType>
+class TCSGSpatialGrid
+{
+public:
+	/// @brief Items covering more cells than this are kept in a list that every query checks instead
+	static constexpr int32 MaxItemCells = 512;
+
+	explicit TCSGSpatialGrid(double InCellSize = 500.0)
+		: CellSize(InCellSize)
+	{
+	}
+
+	/// @brief Adds the item or moves it to its new bounds
+	void Update(ItemType* Item, const FBox& Bounds)
+	{
+		Remove(Item);
+
+		ItemBounds.Add(Item, Bounds);
+		if (IsOversized(Bounds))
+		{
+			Oversized.Add(Item);
+			return;
+		}
+
+		ForEachCell(Bounds, [this, Item](const FIntVector& Cell)
+		{
+			Cells.FindOrAdd(Cell).Add(Item);
+		});
+	}
+
+	void Remove(ItemType* Item)
+	{
+		FBox Bounds;
+		if (!ItemBounds.RemoveAndCopyValue(Item, Bounds))
+		{
+			return;
+		}
+
+		if (IsOversized(Bounds))
+		{
+			Oversized.RemoveSwap(Item);
+			return;
+		}
+
+		ForEachCell(Bounds, [this, Item](const FIntVector& Cell)
+		{
+			if (TArray<ItemType*>* Items = Cells.Find(Cell))
+			{
+				Items->RemoveSwap(Item);
+				if (Items->IsEmpty())
+				{
+					Cells.Remove(Cell);
+				}
+			}
+		});
+	}
+
+	/// @brief Bounds the item was last added with, invalid when it isn't in the grid
+	FBox GetBounds(ItemType* Item) const
+	{
+		const FBox* Bounds = ItemBounds.Find(Item);
+		return Bounds ? *Bounds : FBox(ForceInit);
+	}
+
+	/// @brief Collects every item whose bounds intersect the box, each item is only added once
+	void Query(const FBox& Bounds, TArray<ItemType*>& OutItems) const
+	{
+		if (!Bounds.IsValid)
+		{
+			return;
+		}
+
+		TSet<ItemType*> Found;
+		auto Visit = [&](ItemType* Item)
+		{
+			if (!Found.Contains(Item) && ItemBounds.FindChecked(Item).Intersect(Bounds))
+			{
+				Found.Add(Item);
+				OutItems.Add(Item);
+			}
+		};
+
+		for (ItemType* Item : Oversized)
+		{
+			Visit(Item);
+		}
+
+		if (IsOversized(Bounds))
+		{
+			//walking that many cells is slower than checking every item
+			for (const auto& Pair : ItemBounds)
+			{
+				Visit(Pair.Key);
+			}
+			return;
+		}
+
+		ForEachCell(Bounds, [&](const FIntVector& Cell)
+		{
+			if (const TArray<ItemType*>* Items = Cells.Find(Cell))
+			{
+				for (ItemType* Item : *Items)
+				{
+					Visit(Item);
+				}
+			}
+		});
+	}
+
+	int32 Num() const
+	{
+		return ItemBounds.Num();
+	}
+
+private:
+	FIntVector ToCell(const FVector& Location) const
+	{
+		return FIntVector(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize),
+		                  FMath::FloorToInt32(Location.Z / CellSize));
+	}
+
+	bool IsOversized(const FBox& Bounds) const
+	{
+		const FIntVector Size = ToCell(Bounds.Max) - ToCell(Bounds.Min) + FIntVector(1);
+		return static_cast<int64>(Size.X) * Size.Y * Size.Z > MaxItemCells;
+	}
+
+	template <typename FuncType>
+	void ForEachCell(const FBox& Bounds, FuncType&& Func) const
+	{
+		const FIntVector Min = ToCell(Bounds.Min);
+		const FIntVector Max = ToCell(Bounds.Max);
+		for (int32 X = Min.X; X <= Max.X; ++X)
+		{
+			for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+			{
+				for (int32 Z = Min.Z; Z <= Max.Z; ++Z)
+				{
+					Func(FIntVector(X, Y, Z));
+				}
+			}
+		}
+	}
+
+	double CellSize;
+	TMap<FIntVector, TArray<ItemType*>> Cells;
+	TMap<ItemType*, FBox> ItemBounds;
+	TArray<ItemType*> Oversized;
+};
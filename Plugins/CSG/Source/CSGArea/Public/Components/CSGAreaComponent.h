@@ -3,10 +3,26 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "CSGMeshOperations.h"
 #include "Components/SphereComponent.h"
 #include "CSGAreaComponent.generated.h"
 
-/// @brief The area to perform CSG around, this is a sphere which is active on the provided Collision channel
+class UCSGAreaComponent;
+
+/// @brief How the tessellation of sphere and capsule cutters is picked
+UENUM(BlueprintType)
+enum class ECSGCutterResolutionPolicy : uint8
+{
+	/// @brief Always use CutterResolution
+	Fixed,
+	/// @brief Pick the resolution from the radius and the size on screen, within the bounds of the plugin settings
+	Adaptive
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCSGAreaChanged, UCSGAreaComponent*);
+
+/// @brief The area to perform CSG around, this is a sphere which is active on the provided Collision channel.
+/// Other cutter shapes keep the sphere as their overlap bounds, it gets sized to contain the whole shape
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class CSGAREA_API UCSGAreaComponent : public USphereComponent
 {
@@ -20,11 +36,90 @@ public:
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
 	                           FActorComponentTickFunction* ThisTickFunction) override;
 
+	virtual void UpdateBodySetup() override;
+
+	/// @brief Broadcast when the shape of the area changed, transform changes go through TransformUpdated instead
+	FOnCSGAreaChanged OnAreaChanged;
+
+	/// Returns the mesh this area cuts with, in local space and with every triangle set to MaterialID.
+	/// The mesh is shared by every CSG component the area overlaps and only rebuilt when the radius or the
+	/// resolution of the area changes
+	TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> GetCutterMesh(int32 MaterialID) const;
+
+	/// Radius of the sphere containing the whole cutter in world space. The cutters are scaled by the area's transform,
+	/// so this uses the largest axis scale where the scaled sphere radius of the component uses the smallest
+	float GetCutterWorldRadius() const
+	{
+		return GetUnscaledSphereRadius() * GetComponentTransform().GetMaximumAxisScale();
+	}
+
+	/// @brief Shape actually used for cutting, mesh based shapes fall back to a sphere without a mesh
+	ECSGAreaShape GetCutterShape() const;
+
+	/// @brief Half extents of the box, or radius and half height of the capsule, depending on the shape
+	FVector GetCutterExtent() const;
+
+	/// @brief Applies changes to the cutter shape properties, resizing the overlap sphere around the new shape
+	UFUNCTION(BlueprintCallable, Category = "CSG")
+	void UpdateCutterShape();
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG")
+	ECSGAreaShape Shape = ECSGAreaShape::Sphere;
+
+	/// @brief Resolution the cutter is generated with, following ResolutionPolicy
+	int32 GetEffectiveCutterResolution() const;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG")
+	ECSGCutterResolutionPolicy ResolutionPolicy = ECSGCutterResolutionPolicy::Fixed;
+
+	/// @brief Steps along each edge of the box the cutter sphere is generated from, or along the caps of a capsule
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG", meta = (ClampMin = 2, ClampMax = 64,
+		EditCondition = "ResolutionPolicy == ECSGCutterResolutionPolicy::Fixed"))
+	int32 CutterResolution = 6;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG",
+		meta = (EditCondition = "Shape == ECSGAreaShape::Box", EditConditionHides))
+	FVector BoxExtent = FVector(32.0);
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG", meta = (ClampMin = 0,
+		EditCondition = "Shape == ECSGAreaShape::Capsule", EditConditionHides))
+	float CapsuleRadius = 22.0f;
+
+	/// @brief Half height of the capsule including the caps
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG", meta = (ClampMin = 0,
+		EditCondition = "Shape == ECSGAreaShape::Capsule", EditConditionHides))
+	float CapsuleHalfHeight = 44.0f;
+
+	/// @brief Mesh cut with by the Convex and StaticMesh shapes, around the origin of the area
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG", meta = (
+		EditCondition = "Shape == ECSGAreaShape::Convex || Shape == ECSGAreaShape::StaticMesh", EditConditionHides))
+	TObjectPtr<UStaticMesh> CutterStaticMesh;
+
+	/// @brief Layers the area is on, it only cuts CSG components accepting one of them
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG", meta = (Bitmask, BitmaskEnum = "/Script/CSGArea.ECSGLayer"))
+	int32 CSGLayers = 1;
+
+	/// @brief Material of the faces this area cuts, the components use their CSGMaterial when this isn't set
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CSG")
+	TObjectPtr<UMaterialInterface> CutMaterial;
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	TEnumAsByte<ECollisionChannel> CollisionChannel;
+	/// @brief Cutter meshes by material ID, along with the radius, resolution and source mesh they were built for
+	mutable TMap<int32, TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>> CutterMeshes;
+	mutable float CutterMeshRadius = 0.0f;
+	mutable int32 CutterMeshResolution = 0;
+	mutable TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> CutterMeshSource;
+
+	/// @brief Radius of the sphere around the origin containing the whole cutter shape
+	float GetCutterBoundingRadius() const;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 
 #if WITH_EDITORONLY_DATA
 	UPROPERTY()
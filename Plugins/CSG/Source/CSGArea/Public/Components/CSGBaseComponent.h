@@ -3,10 +3,109 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "CSGMeshOperations.h"
+#include "Async/Future.h"
 #include "Components/DynamicMeshComponent.h"
 #include "GeometryScript/CollisionFunctions.h"
 #include "CSGBaseComponent.generated.h"
 
+class UCSGAreaComponent;
+
+/// @brief When the collision of a CSG component gets rebuilt after the areas changed
+UENUM(BlueprintType)
+enum class ECSGCollisionUpdatePolicy : uint8
+{
+	/// @brief Collision is rebuilt together with the visual mesh
+	Immediate,
+	/// @brief Collision is rebuilt at most once every CollisionUpdateInterval seconds
+	RateLimited,
+	/// @brief Collision is rebuilt once the areas stopped changing for CollisionSettleTime seconds
+	OnSettle
+};
+
+/// @brief How a CSG component evaluates its areas
+UENUM(BlueprintType)
+enum class ECSGBackend : uint8
+{
+	/// @brief Mesh booleans on the source mesh, exact but slower with every cut that accumulates
+	MeshBoolean,
+	/// @brief The source mesh is turned into a sparse signed distance field once, areas only re-mesh the bricks
+	/// of the field they touch. Suits heavy volumetric destruction, the result loses the UVs of the source mesh
+	SignedDistanceField
+};
+
+/// @brief What a scratch mesh of a CSG component is used for, every role keeps its own mesh between rebuilds
+enum class ECSGScratchMesh : uint8
+{
+	/// @brief Holds the visual source mesh from GetVisualMesh until the component is marked dirty
+	VisualSource,
+	/// @brief Holds the collision source mesh from GetCollisionMesh until the component is marked dirty
+	CollisionSource,
+	/// @brief Holds the evaluated collision mesh while the collision gets cooked
+	CollisionResult,
+	Count
+};
+
+/// @brief Size of the scratch meshes of a CSG component, peaks are the largest meshes seen since BeginPlay
+USTRUCT(BlueprintType)
+struct FCSGScratchMeshStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	int32 MeshCount = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	int32 PeakVertexCount = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	int32 PeakTriangleCount = 0;
+};
+
+/// Rebuild counters of a CSG component since BeginPlay. The CSG stat group only counts totals over all components,
+/// per component the counters are read through GetRebuildStats or listed by the CSG.DumpStats console command
+USTRUCT(BlueprintType)
+struct FCSGRebuildStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	int32 RebuildCount = 0;
+
+	/// @brief Rebuilds applied during the last second
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	int32 RebuildsPerSecond = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	float LastEvaluationMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	float TotalEvaluationMs = 0.0f;
+
+	/// @brief Time the last collision update spent on the game thread
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	float LastCollisionMs = 0.0f;
+
+	/// @brief Triangles of the source meshes and of the result of the last rebuild
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	int32 InputTriangleCount = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CSG")
+	int32 OutputTriangleCount = 0;
+};
+
+/// @brief Everything a CSG result depends on, when this doesn't change between frames the rebuild can be skipped
+struct FCSGFingerprint
+{
+	FTransform ComponentTransform;
+	TArray<FCSGAreaSnapshot> Areas;
+	TArray<FCSGAreaSnapshot> CollisionAreas;
+	bool bReverse = false;
+
+	bool VisualEquals(const FCSGFingerprint& Other) const;
+	bool CollisionEquals(const FCSGFingerprint& Other) const;
+};
+
 /// @brief Base component for performing intersecting CSG,
 /// To use this component user's should implement the GetVisualMesh and GetCollisionMesh functions
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent), Blueprintable)
@@ -21,6 +120,19 @@ public:
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport) override;
+	virtual void OnRegister() override;
+	virtual void OnComponentDestroyed(bool bDestroyingHierarchy) override;
+
+	/// @brief Applies Materials, CSGMaterial and the area materials to the slots that don't use them yet
+	void SyncMaterials();
+
+	/// Material ID of the faces cut by the area, areas with their own material get a slot after CSGMaterial
+	///
+	/// @param InOutAreaMaterials Area materials by slot, the material of the area is added when it's missing
+	int32 GetAreaMaterialID(const UCSGAreaComponent* Area, TArray<UMaterialInterface*>& InOutAreaMaterials) const;
 
 	/// Function used for retrieving the Visual Mesh of the component,
 	/// 
@@ -38,9 +150,54 @@ protected:
 	UFUNCTION(BlueprintNativeEvent)
 	void GetCollisionMesh(UDynamicMesh* OutMesh);
 
-	void RebuildMesh(UDynamicMesh* OutMesh, UDynamicMesh* FullMesh) const;
+	/// @brief Collects all areas intersecting the source bounds of the component
+	void GatherAreas(TArray<const UCSGAreaComponent*>& OutAreas) const;
+
+	/// Snapshots the areas, the component isn't modified
+	///
+	/// @param OutAreaMaterials Area materials the material IDs of the snapshots refer to,
+	/// ApplyRebuildResult moves them into AreaMaterials together with the visual result
+	FCSGFingerprint MakeFingerprint(const TArray<const UCSGAreaComponent*>& AllAreas,
+	                                TArray<UMaterialInterface*>& OutAreaMaterials) const;
+
+	/// Copies the source meshes and the areas, so the CSG can be evaluated without touching the component
+	///
+	/// @param bUseCaches Whether the evaluation may use and update the chunks, fields and incremental results
+	/// of the component. Sources already held by those aren't copied. Without, the sources are left for the
+	/// caller to fill in
+	void MakeRebuildInput(const FCSGFingerprint& Fingerprint, FCSGRebuildInput& OutInput, bool bUseCaches = true);
+
+	bool IsCollisionUpdateDue(double Now) const;
+
+	/// @brief Parks the component with the scheduler until IsRebuildDue, instead of queuing it every frame
+	void RequestDeferredRebuild();
+
+	/// @brief Returns the scratch mesh for the role, it's created the first time and reused afterwards
+	UDynamicMesh* GetScratchMesh(ECSGScratchMesh Role);
+
+	/// @brief Source meshes kept in their scratch meshes, GetVisualMesh and GetCollisionMesh only get called again
+	/// after MarkCSGDirty
+	const UE::Geometry::FDynamicMesh3& FetchVisualSource();
+	const UE::Geometry::FDynamicMesh3& FetchCollisionSource();
+
+	/// @brief Fetches the source meshes and keeps their bounds for GetLocalSourceBounds
+	void UpdateSourceBounds();
+
+	static FBox GetMeshBounds(const UE::Geometry::FDynamicMesh3& Mesh);
 
-	void ReverseRebuildMesh(UDynamicMesh* OutMesh) const;
+	/// @brief Whether the area has to be evaluated for a component with the given world space source bounds
+	bool IsAffectedBy(const UCSGAreaComponent* Area, const FBox& WorldBounds) const;
+
+	void UpdateScratchStats(const UE::Geometry::FDynamicMesh3& Mesh);
+
+	void UpdateRebuildStats(const FCSGRebuildResult& Result, double CollisionSeconds);
+
+	/// Called when a new visual result was swapped into the component
+	///
+	/// @param bMatchesSource Whether the result is the unmodified visual source mesh, because no area touches it
+	virtual void OnVisualResultApplied(bool bMatchesSource)
+	{
+	}
 
 	/// @brief Collision options to use when constructing the collision shape
 	UPROPERTY(EditAnywhere, Category = "Collision | CSG")
@@ -51,18 +208,247 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Collision | CSG")
 	bool bDoReverseCSG = false;
 
+	/// @brief Area layers cutting the visual mesh
+	UPROPERTY(EditAnywhere, Category = "CSG", meta = (Bitmask, BitmaskEnum = "/Script/CSGArea.ECSGLayer"))
+	int32 CSGLayers = 0xFF;
+
+	/// @brief Area layers cutting the collision mesh, areas only on other layers never rebuild the collision
+	UPROPERTY(EditAnywhere, Category = "Collision | CSG", meta = (Bitmask, BitmaskEnum = "/Script/CSGArea.ECSGLayer"))
+	int32 CollisionCSGLayers = 0xFF;
+
+	/// @brief Whether the booleans should be evaluated on a worker thread,
+	/// the previous result stays visible until the new one is finished
+	UPROPERTY(EditAnywhere, Category = "CSG")
+	bool bAsyncRebuild = false;
+
+	UPROPERTY(EditAnywhere, Category = "CSG")
+	ECSGBackend Backend = ECSGBackend::MeshBoolean;
+
+	/// @brief Distance between the samples of the signed distance field, smaller values keep more detail
+	UPROPERTY(EditAnywhere, Category = "CSG", meta = (ClampMin = 0.1,
+		EditCondition = "Backend == ECSGBackend::SignedDistanceField"))
+	float SdfVoxelSize = 5.0f;
+
+	/// @brief Whether areas should cut the exact sphere where possible instead of a tessellated one,
+	/// cuts the analytic path can't handle still fall back to a mesh boolean
+	UPROPERTY(EditAnywhere, Category = "CSG")
+	bool bAnalyticSphereCut = true;
+
+	/// @brief Whether box and convex areas should be intersected by cutting with their face planes instead of
+	/// a mesh boolean, subtracting them always uses the boolean
+	UPROPERTY(EditAnywhere, Category = "CSG")
+	bool bAnalyticConvexCut = true;
+
+	/// @brief When the collision gets rebuilt, cooking collision is a lot more expensive than updating the visual mesh
+	UPROPERTY(EditAnywhere, Category = "Collision | CSG")
+	ECSGCollisionUpdatePolicy CollisionUpdatePolicy = ECSGCollisionUpdatePolicy::Immediate;
+
+	UPROPERTY(EditAnywhere, Category = "Collision | CSG", meta = (ClampMin = 0,
+		EditCondition = "CollisionUpdatePolicy == ECSGCollisionUpdatePolicy::RateLimited"))
+	float CollisionUpdateInterval = 0.2f;
+
+	UPROPERTY(EditAnywhere, Category = "Collision | CSG", meta = (ClampMin = 0,
+		EditCondition = "CollisionUpdatePolicy == ECSGCollisionUpdatePolicy::OnSettle"))
+	float CollisionSettleTime = 0.25f;
+
+	/// @brief The collision mesh gets simplified to at most this amount of triangles once, before any CSG is done.
+	/// 0 uses the collision mesh as is
+	UPROPERTY(EditAnywhere, Category = "Collision | CSG", meta = (ClampMin = 0))
+	int32 CollisionProxyTriangleCount = 0;
+
+	/// @brief Meshes with more triangles than this get split into closed chunks of at most this size,
+	/// only chunks touched by a changed area get rebuilt. 0 disables chunking
+	UPROPERTY(EditAnywhere, Category = "CSG", meta = (ClampMin = 0))
+	int32 MaxChunkTriangles = 0;
+
+	/// @brief Whether subtractive CSG should only subtract areas added since the last rebuild from its result,
+	/// the mesh is rebuilt from the source when an area moves or leaves. Suits damage that only ever adds cuts
+	UPROPERTY(EditAnywhere, Category = "CSG", meta = (EditCondition = "bDoReverseCSG"))
+	bool bIncrementalCSG = false;
+
+	/// @brief Whether the CSG result is kept when the component is saved into a SaveGame archive or streamed out,
+	/// restoring it doesn't run any booleans
+	UPROPERTY(EditAnywhere, Category = "CSG")
+	bool bPersistCSGResult = false;
+
+	/// @brief Whether the output should be cleaned up after the booleans: welding open seams, removing slivers
+	/// and simplifying around the cuts when the mesh exceeds TriangleBudget
+	UPROPERTY(EditAnywhere, Category = "CSG | Post Process")
+	bool bPostProcess = false;
+
+	UPROPERTY(EditAnywhere, Category = "CSG | Post Process", meta = (ClampMin = 0, EditCondition = "bPostProcess"))
+	float WeldTolerance = 0.01f;
+
+	/// @brief The output gets simplified around the cuts down to this amount of triangles, 0 disables simplification
+	UPROPERTY(EditAnywhere, Category = "CSG | Post Process", meta = (ClampMin = 0, EditCondition = "bPostProcess"))
+	int32 TriangleBudget = 0;
+
+	/// @brief Rings of triangles around the cut faces the simplification may touch
+	UPROPERTY(EditAnywhere, Category = "CSG | Post Process", meta = (ClampMin = 0, EditCondition = "bPostProcess"))
+	int32 CutRegionRings = 2;
+
+	/// @brief Set once the result has been baked into static mesh components, a baked component doesn't rebuild,
+	/// stays hidden without collision and is left out of cooked builds. Clear it to go back to runtime CSG
+	UPROPERTY(EditAnywhere, Category = "CSG")
+	bool bCSGBaked = false;
+
 	UPROPERTY(EditAnywhere, Category = "Visual")
 	TArray<TObjectPtr<UMaterialInterface>> Materials;
 	UPROPERTY(EditAnywhere, Category = "Visual")
 	TObjectPtr<UMaterialInterface> CSGMaterial;
 
-	UPROPERTY()
-	TObjectPtr<UDynamicMeshPool> MeshPool;
+	/// @brief Cut materials of the areas that have their own, in the order their slots were added after CSGMaterial
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UMaterialInterface>> AreaMaterials;
+
+	/// @brief Area materials of the rebuild in flight, they replace AreaMaterials when its visual result is applied
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UMaterialInterface>> PendingAreaMaterials;
+
+	/// @brief Scratch meshes indexed by ECSGScratchMesh, they live as long as the component
+	/// so rebuilds don't have to request and return pooled meshes every tick
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UDynamicMesh>> ScratchMeshes;
+
+	FCSGScratchMeshStats ScratchStats;
+
+	/// @brief Whether the source scratch meshes hold the current source meshes
+	bool bVisualSourceFetched = false;
+	bool bCollisionSourceFetched = false;
+
+	/// @brief Local bounds of both source meshes, invalid until they have been fetched
+	FBox CachedSourceBounds = FBox(ForceInit);
+
+	FCSGRebuildStats RebuildStats;
+
+	/// @brief Times of the rebuilds applied during the last second, for RebuildsPerSecond
+	TArray<double> RecentRebuildTimes;
+
+	/// @brief Fingerprint of the last rebuild, unset when the next tick has to rebuild regardless
+	TOptional<FCSGFingerprint> LastFingerprint;
+
+	/// @brief Simplified collision mesh, built once when CollisionProxyTriangleCount is set
+	TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> CollisionProxy;
+
+	/// @brief Set when the visual mesh got rebuilt without the collision
+	bool bCollisionStale = false;
+	double LastCollisionUpdateTime = TNumericLimits<double>::Lowest();
+	double LastAreaChangeTime = 0.0;
+
+	/// @brief Chunks of the source meshes when chunking is enabled, dropped when the source meshes change
+	TSharedPtr<FCSGChunkCache, ESPMode::ThreadSafe> VisualChunks;
+	TSharedPtr<FCSGChunkCache, ESPMode::ThreadSafe> CollisionChunks;
+
+	/// @brief Signed distance fields of the source meshes when using the SDF backend, dropped when they change
+	TSharedPtr<FCSGSdfCache, ESPMode::ThreadSafe> VisualSdf;
+	TSharedPtr<FCSGSdfCache, ESPMode::ThreadSafe> CollisionSdf;
+
+	/// @brief Previous subtractive results when using bIncrementalCSG
+	TSharedPtr<FCSGIncrementalCache, ESPMode::ThreadSafe> VisualIncremental;
+	TSharedPtr<FCSGIncrementalCache, ESPMode::ThreadSafe> CollisionIncremental;
+
+	/// @brief Result restored by LoadCSGState, applied by the next rebuild instead of evaluating the areas
+	TSharedPtr<FCSGRebuildResult> RestoredResult;
+
+	/// @brief Background rebuild in flight when using bAsyncRebuild
+	TFuture<void> PendingRebuild;
+	TSharedPtr<FCSGRebuildResult, ESPMode::ThreadSafe> PendingResult;
 
 public:
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
-	                           FActorComponentTickFunction* ThisTickFunction) override;
+	/// @brief Forces a rebuild on the next tick, call this when the source meshes have changed
+	UFUNCTION(BlueprintCallable, Category = "CSG")
+	void MarkCSGDirty();
+
+	/// Writes the current CSG result into a compact, compressed blob
+	///
+	/// @param OutState Output data, can be passed to LoadCSGState of this component later on
+	UFUNCTION(BlueprintCallable, Category = "CSG")
+	void SaveCSGState(TArray<uint8>& OutState) const;
+
+	/// Restores a result written by SaveCSGState, the areas overlapping the component at the next rebuild
+	/// are assumed to be the ones the result was built with
+	///
+	/// @return False when the data couldn't be read
+	UFUNCTION(BlueprintCallable, Category = "CSG")
+	bool LoadCSGState(const TArray<uint8>& State);
+
+	virtual void Serialize(FArchive& Ar) override;
+
+	UFUNCTION(BlueprintCallable, Category = "CSG")
+	FCSGScratchMeshStats GetScratchMeshStats() const
+	{
+		return ScratchStats;
+	}
+
+	UFUNCTION(BlueprintCallable, Category = "CSG")
+	FCSGRebuildStats GetRebuildStats() const
+	{
+		return RebuildStats;
+	}
+
+	/// @brief Queues the component with the rebuild scheduler of the world
+	void RequestRebuild();
+
+	/// @brief Whether a component parked with the scheduler can rebuild, because its background rebuild finished
+	/// or its stale collision is allowed to catch up
+	bool IsRebuildDue(double Now) const;
+
+	/// @brief Whether areas on the layers cut the visual or the collision mesh
+	bool AcceptsLayers(int32 Layers) const
+	{
+		return (Layers & (CSGLayers | CollisionCSGLayers)) != 0;
+	}
+
+	/// @brief World space bounds areas have to intersect to affect the component
+	FBox GetCSGSourceBounds() const;
+
+	/// Bounds of the uncut source meshes in the local space of the component, by default the bounds of the visual
+	/// and collision source meshes fetched when the component began play or got marked dirty
+	virtual FBox GetLocalSourceBounds() const;
+
+	/// @brief Whether the mesh of the component has been drawn lately, hidden components get rebuilt later
+	virtual bool WasCSGRecentlyRendered(float Tolerance) const
+	{
+		return WasRecentlyRendered(Tolerance);
+	}
+
+	/// @brief Rebuilds the mesh when anything it depends on changed, called by UCSGRebuildSubsystem once the
+	/// component's turn came up
+	void ProcessRebuild();
+
+	/// Game thread part of a rebuild, checks whether anything changed and snapshots the component
+	///
+	/// @param OutInput Input to evaluate with CSG::Evaluate when this returns true
+	/// @return False when there is nothing to evaluate, or when the evaluation was started asynchronously
+	bool BeginRebuild(FCSGRebuildInput& OutInput);
+
+	/// @brief Swaps the rebuilt meshes into the component and updates the collision
+	void ApplyRebuildResult(FCSGRebuildResult& Result);
+
+	/// Evaluates the CSG against the given areas right away, without changing anything on the component.
+	/// Used for baking, where neither the areas nor the component have begun play
+	///
+	/// @param CandidateAreas Areas to evaluate, the ones not intersecting the source meshes are skipped
+	/// @param OutResult Visual and collision result, in the local space of the component
+	/// @param OutMaterials Materials of the result by material ID, the faces created by the areas come last
+	void EvaluateCSG(const TArray<const UCSGAreaComponent*>& CandidateAreas, FCSGRebuildResult& OutResult,
+	                 TArray<UMaterialInterface*>& OutMaterials);
+
+	bool IsCSGBaked() const
+	{
+		return bCSGBaked;
+	}
+
+	/// Marks the component as replaced by a baked result, see bCSGBaked
+	///
+	/// @param bEditorOnly Whether the component should be left out of cooked builds,
+	/// only possible when nothing is attached to it
+	void SetCSGBaked(bool bBaked, bool bEditorOnly);
+
+	const FGeometryScriptCollisionFromMeshOptions& GetCollisionOptions() const
+	{
+		return CollisionOptions;
+	}
 
 protected:
 	virtual void GetVisualMesh_Implementation(UDynamicMesh* OutMesh)
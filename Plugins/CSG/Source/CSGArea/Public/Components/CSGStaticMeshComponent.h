@@ -19,13 +19,40 @@ public:
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	virtual void GetVisualMesh_Implementation(UDynamicMesh* OutMesh) override;
 	virtual void GetCollisionMesh_Implementation(UDynamicMesh* OutMesh) override;
 
+	/// @brief Bounds of the source mesh, the result of the CSG can be a lot smaller than the mesh being cut
+	virtual FBox GetLocalSourceBounds() const override;
+
+	/// @brief Instances are drawn by the instance subsystem, the component itself has no proxy then
+	virtual bool WasCSGRecentlyRendered(float Tolerance) const override;
+
+	virtual void OnVisualResultApplied(bool bMatchesSource) override;
+	virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport) override;
+
+	/// @brief No proxy is created while the mesh is drawn as an instance
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+
+	void SetInstanced(bool bNewInstanced);
+
+#if WITH_EDITOR
+	void OnMeshBuilt(UStaticMesh* BuiltMesh);
+#endif
+
 	UPROPERTY(EditAnywhere, Category = "Mesh")
 	TObjectPtr<UStaticMesh> Mesh;
 
+	/// @brief Whether the mesh should be drawn through an instanced static mesh shared with the other components
+	/// using the same mesh and materials while no area touches it. Only applies to subtractive CSG
+	UPROPERTY(EditAnywhere, Category = "Mesh")
+	bool bInstanceWhenUncut = true;
+
+	/// @brief Set while the mesh is drawn as an instance, the component only provides the collision then
+	bool bInstanced = false;
+
 #if WITH_EDITORONLY_DATA
 	UPROPERTY()
 	TObjectPtr<UStaticMeshComponent> MeshComponent;
@@ -33,9 +60,4 @@ protected:
 
 	virtual void OnRegister() override;
 	virtual void OnComponentDestroyed(bool bDestroyingHierarchy) override;
-
-public:
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
-	                           FActorComponentTickFunction* ThisTickFunction) override;
 };
@@ -0,0 +1,35 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class CSGAreaEditor : ModuleRules
+{
+	public CSGAreaEditor(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(
+			new[]
+			{
+				"Core"
+			}
+		);
+
+		PrivateDependencyModuleNames.AddRange(
+			new[]
+			{
+				"CoreUObject",
+				"Engine",
+				"Slate",
+				"SlateCore",
+				"UnrealEd",
+				"ToolMenus",
+				"GeometryScriptingCore",
+				"GeometryScriptingEditor",
+				"GeometryFramework",
+				"GeometryCore",
+				"CSGArea"
+			}
+		);
+	}
+}
@@ -0,0 +1,71 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CSGAreaEditor.h"
+
+#include "CSGBake.h"
+#include "Editor.h"
+#include "ScopedTransaction.h"
+#include "ToolMenus.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
+
+#define LOCTEXT_NAMESPACE "FCSGAreaEditorModule"
+
+DEFINE_LOG_CATEGORY(LogCSGEditor);
+
+void FCSGAreaEditorModule::StartupModule()
+{
+	UToolMenus::RegisterStartupCallback(
+		FSimpleMulticastDelegate::FDelegate::CreateRaw(this, &FCSGAreaEditorModule::RegisterMenus));
+}
+
+void FCSGAreaEditorModule::ShutdownModule()
+{
+	UToolMenus::UnRegisterStartupCallback(this);
+	UToolMenus::UnregisterOwner(this);
+}
+
+void FCSGAreaEditorModule::RegisterMenus()
+{
+	FToolMenuOwnerScoped OwnerScoped(this);
+
+	UToolMenu* Menu = UToolMenus::Get()->ExtendMenu("LevelEditor.MainMenu.Tools");
+	FToolMenuSection& Section = Menu->FindOrAddSection("CSG", LOCTEXT("CSGSection", "CSG"));
+	Section.AddMenuEntry(
+		"BakeCSG",
+		LOCTEXT("BakeCSG", "Bake CSG"),
+		LOCTEXT("BakeCSGTooltip",
+		        "Bakes the CSG of every component in the level into static meshes and swaps them in, "
+		        "so the cooked level doesn't evaluate any CSG"),
+		FSlateIcon(),
+		FUIAction(FExecuteAction::CreateRaw(this, &FCSGAreaEditorModule::BakeCurrentLevel),
+		          FCanExecuteAction::CreateLambda([]
+		          {
+			          return GEditor && !GEditor->PlayWorld;
+		          })));
+}
+
+void FCSGAreaEditorModule::BakeCurrentLevel()
+{
+	UWorld* World = GEditor->GetEditorWorldContext().World();
+	if (!World)
+	{
+		return;
+	}
+
+	//the created assets stay dirty, they get saved together with the level
+	TArray<UPackage*> Packages;
+	int32 Baked;
+	{
+		const FScopedTransaction Transaction(LOCTEXT("BakeCSGTransaction", "Bake CSG"));
+		Baked = CSGBake::BakeWorld(World, CSGBake::GetDefaultAssetFolder(World), Packages);
+	}
+
+	FNotificationInfo Info(FText::Format(LOCTEXT("BakeCSGDone", "Baked {0} CSG components"), Baked));
+	Info.ExpireDuration = 4.0f;
+	FSlateNotificationManager::Get().AddNotification(Info);
+}
+
+#undef LOCTEXT_NAMESPACE
+
+IMPLEMENT_MODULE(FCSGAreaEditorModule, CSGAreaEditor)
@@ -0,0 +1,155 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGBake.h"
+
+#include "CSGAreaEditor.h"
+#include "CSGMeshOperations.h"
+#include "EngineUtils.h"
+#include "UDynamicMesh.h"
+#include "Components/CSGAreaComponent.h"
+#include "Components/CSGBaseComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "GeometryScript/CollisionFunctions.h"
+#include "GeometryScript/CreateNewAssetUtilityFunctions.h"
+
+FString CSGBake::GetDefaultAssetFolder(const UWorld* World)
+{
+	return FString::Printf(TEXT("/Game/CSGBaked/%s"), *World->GetName());
+}
+
+int32 CSGBake::BakeWorld(UWorld* World, const FString& AssetFolder, TArray<UPackage*>& OutPackages)
+{
+	//areas only join the area index once they begin play, so they are collected from the actors instead
+	TArray<UCSGAreaComponent*> Areas;
+	TArray<UCSGBaseComponent*> Components;
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		It->GetComponents(Areas, true);
+		It->GetComponents(Components, true);
+	}
+
+	const TArray<const UCSGAreaComponent*> CandidateAreas(Areas);
+	int32 Baked = 0;
+	for (UCSGBaseComponent* Component : Components)
+	{
+		if (Component->IsCSGBaked())
+		{
+			continue;
+		}
+
+		//the component skips the areas not reaching its source meshes itself
+		if (BakeComponent(Component, CandidateAreas, AssetFolder, OutPackages))
+		{
+			++Baked;
+		}
+	}
+
+	return Baked;
+}
+
+bool CSGBake::BakeComponent(UCSGBaseComponent* Component, const TArray<const UCSGAreaComponent*>& Areas,
+                            const FString& AssetFolder, TArray<UPackage*>& OutPackages)
+{
+	AActor* Owner = Component->GetOwner();
+
+	FCSGRebuildResult Result;
+	TArray<UMaterialInterface*> Materials;
+	Component->EvaluateCSG(Areas, Result, Materials);
+
+	//a static mesh can't hold collision without render data, so the component keeps doing the CSG at runtime
+	if (Result.VisualMesh.TriangleCount() == 0 && Result.bHasCollision && Result.CollisionMesh.TriangleCount() > 0)
+	{
+		UE_LOG(LogCSGEditor, Warning, TEXT("Not baking %s, its visual mesh got removed but %d collision triangles are left"),
+		       *Component->GetPathName(), Result.CollisionMesh.TriangleCount());
+		return false;
+	}
+
+	//an area that removed the whole mesh leaves nothing to swap in
+	UStaticMesh* StaticMesh = nullptr;
+	if (Result.VisualMesh.TriangleCount() > 0)
+	{
+		EGeometryScriptOutcomePins Outcome;
+		FString AssetPath;
+		FString AssetName;
+		UGeometryScriptLibrary_CreateNewAssetFunctions::CreateUniqueNewAssetPathName(
+			AssetFolder, FString::Printf(TEXT("SM_CSG_%s_%s"), *Owner->GetName(), *Component->GetName()),
+			AssetPath, AssetName, FGeometryScriptUniqueAssetNameOptions(), Outcome);
+		if (Outcome != EGeometryScriptOutcomePins::Success)
+		{
+			UE_LOG(LogCSGEditor, Warning, TEXT("No asset name available for baking %s"), *Component->GetPathName());
+			return false;
+		}
+
+		UDynamicMesh* VisualMesh = NewObject<UDynamicMesh>();
+		VisualMesh->SetMesh(MoveTemp(Result.VisualMesh));
+
+		//the simple collision comes from the collision result below
+		FGeometryScriptCreateNewStaticMeshAssetOptions Options;
+		Options.bEnableCollision = false;
+		StaticMesh = UGeometryScriptLibrary_CreateNewAssetFunctions::CreateNewStaticMeshAssetFromMesh(
+			VisualMesh, AssetPath, Options, Outcome);
+		if (Outcome != EGeometryScriptOutcomePins::Success || !StaticMesh)
+		{
+			UE_LOG(LogCSGEditor, Warning, TEXT("Failed to create %s for %s"), *AssetPath, *Component->GetPathName());
+			return false;
+		}
+
+		//slots follow the material IDs of the result, the faces created by the areas come last
+		TArray<FStaticMaterial> StaticMaterials;
+		for (int32 i = 0; i < Materials.Num(); ++i)
+		{
+			StaticMaterials.Emplace(Materials[i], *FString::Printf(TEXT("CSG_%d"), i));
+		}
+		StaticMesh->SetStaticMaterials(StaticMaterials);
+
+		if (Result.bHasCollision && Result.CollisionMesh.TriangleCount() > 0)
+		{
+			UDynamicMesh* CollisionMesh = NewObject<UDynamicMesh>();
+			CollisionMesh->SetMesh(MoveTemp(Result.CollisionMesh));
+			UGeometryScriptLibrary_CollisionFunctions::SetStaticMeshCollisionFromMesh(
+				CollisionMesh, StaticMesh, Component->GetCollisionOptions());
+		}
+
+		StaticMesh->PostEditChange();
+		StaticMesh->MarkPackageDirty();
+		OutPackages.AddUnique(StaticMesh->GetPackage());
+	}
+
+	Owner->Modify();
+
+	//the CSG component can only be left out of the build when nothing depends on it being there
+	USceneComponent* Parent = Component->GetAttachParent();
+	const bool bEditorOnly = Parent && Component->GetAttachChildren().IsEmpty();
+
+	if (StaticMesh)
+	{
+		UStaticMeshComponent* BakedComponent = NewObject<UStaticMeshComponent>(
+			Owner, MakeUniqueObjectName(Owner, UStaticMeshComponent::StaticClass(),
+			                            *FString::Printf(TEXT("%s_Baked"), *Component->GetName())),
+			RF_Transactional);
+		BakedComponent->SetStaticMesh(StaticMesh);
+		BakedComponent->SetMobility(Component->Mobility);
+		BakedComponent->SetCollisionProfileName(Component->GetCollisionProfileName());
+
+		if (bEditorOnly)
+		{
+			BakedComponent->SetupAttachment(Parent, Component->GetAttachSocketName());
+			BakedComponent->SetRelativeTransform(Component->GetRelativeTransform());
+		}
+		else
+		{
+			//the hidden CSG component stays in as the parent
+			BakedComponent->SetupAttachment(Component);
+		}
+
+		Owner->AddInstanceComponent(BakedComponent);
+		BakedComponent->RegisterComponent();
+	}
+
+	Component->SetCSGBaked(true, bEditorOnly);
+	OutPackages.AddUnique(Owner->GetPackage());
+
+	return true;
+}
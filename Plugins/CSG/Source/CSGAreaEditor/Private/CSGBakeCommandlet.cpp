@@ -0,0 +1,94 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGBakeCommandlet.h"
+
+#include "CSGAreaEditor.h"
+#include "CSGBake.h"
+#include "FileHelpers.h"
+#include "Engine/World.h"
+
+UCSGBakeCommandlet::UCSGBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UCSGBakeCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> Values;
+	ParseCommandLine(*Params, Tokens, Switches, Values);
+
+	const FString* Maps = Values.Find(TEXT("Map"));
+	if (!Maps)
+	{
+		UE_LOG(LogCSGEditor, Error, TEXT("Usage: -run=CSGBake -Map=/Game/Maps/First,/Game/Maps/Second [-Folder=/Game/CSGBaked]"));
+		return 1;
+	}
+
+	const FString* Folder = Values.Find(TEXT("Folder"));
+
+	TArray<FString> MapNames;
+	Maps->ParseIntoArray(MapNames, TEXT(","));
+
+	int32 Failures = 0;
+	for (const FString& MapName : MapNames)
+	{
+		if (!BakeMap(MapName, Folder ? *Folder : FString()))
+		{
+			++Failures;
+		}
+
+		//the maps are independent, there is no reason to keep the previous one around
+		CollectGarbage(RF_NoFlags);
+	}
+
+	return Failures > 0 ? 1 : 0;
+}
+
+bool UCSGBakeCommandlet::BakeMap(const FString& MapName, const FString& AssetFolder)
+{
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (!World)
+	{
+		UE_LOG(LogCSGEditor, Error, TEXT("Failed to load map %s"), *MapName);
+		return false;
+	}
+
+	//the components have to be registered for their transforms and bounds to be valid
+	World->AddToRoot();
+	World->WorldType = EWorldType::Editor;
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+		                 .AllowAudioPlayback(false)
+		                 .CreatePhysicsScene(false)
+		                 .CreateNavigation(false)
+		                 .CreateAISystem(false)
+		                 .ShouldSimulatePhysics(false)
+		                 .EnableTraceCollision(false)
+		                 .SetTransactional(false));
+	}
+	World->UpdateWorldComponents(true, false);
+
+	TArray<UPackage*> Packages;
+	const int32 Baked = CSGBake::BakeWorld(World, AssetFolder.IsEmpty() ? CSGBake::GetDefaultAssetFolder(World) : AssetFolder,
+	                                       Packages);
+	UE_LOG(LogCSGEditor, Display, TEXT("Baked %d CSG components in %s"), Baked, *MapName);
+
+	const bool bSaved = Packages.IsEmpty() || UEditorLoadingAndSavingUtils::SavePackages(Packages, false);
+	if (!bSaved)
+	{
+		UE_LOG(LogCSGEditor, Error, TEXT("Failed to save the baked packages of %s"), *MapName);
+	}
+
+	World->CleanupWorld();
+	World->RemoveFromRoot();
+
+	return bSaved;
+}
@@ -0,0 +1,31 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCSGAreaComponent;
+class UCSGBaseComponent;
+
+/// @brief Bakes CSG results into static mesh assets and swaps static mesh components in for the CSG components,
+/// so cooked builds of levels whose areas never move don't evaluate any CSG at runtime
+namespace CSGBake
+{
+	/// @brief Folder the static meshes of the world get created in when no other folder is given
+	CSGAREAEDITOR_API FString GetDefaultAssetFolder(const UWorld* World);
+
+	/// Bakes every CSG component of the world that hasn't been baked yet, against the areas placed in the world
+	///
+	/// @param AssetFolder Long package path the static meshes get created in
+	/// @param OutPackages Packages that got created or modified and have to be saved, including the actor packages
+	/// @return Amount of components that got baked
+	CSGAREAEDITOR_API int32 BakeWorld(UWorld* World, const FString& AssetFolder, TArray<UPackage*>& OutPackages);
+
+	/// Evaluates the component against the areas and replaces it with a static mesh component,
+	/// the visual result becomes the render mesh and the collision result the simple collision of the asset
+	///
+	/// @param Areas Candidate areas, the component skips the ones not reaching its source meshes
+	/// @return False when the asset couldn't be created or only the collision is left, the component is left as is then
+	CSGAREAEDITOR_API bool BakeComponent(UCSGBaseComponent* Component, const TArray<const UCSGAreaComponent*>& Areas,
+	                                     const FString& AssetFolder, TArray<UPackage*>& OutPackages);
+}
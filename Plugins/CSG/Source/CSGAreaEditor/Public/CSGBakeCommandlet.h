@@ -0,0 +1,25 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CSGBakeCommandlet.generated.h"
+
+/// @brief Bakes the CSG components of maps into static meshes, meant to run before cooking
+///
+/// Usage: -run=CSGBake -Map=/Game/Maps/First,/Game/Maps/Second [-Folder=/Game/CSGBaked]
+UCLASS()
+class CSGAREAEDITOR_API UCSGBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCSGBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/// @return False when the map couldn't be loaded or saved
+	bool BakeMap(const FString& MapName, const FString& AssetFolder);
+};
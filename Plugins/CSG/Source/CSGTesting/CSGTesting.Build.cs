@@ -20,7 +20,13 @@ public class CSGTesting : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
-				"FunctionalTesting"
+				"FunctionalTesting",
+				"CSGArea",
+				"GeometryCore",
+				"GeometryFramework",
+				"GeometryScriptingCore",
+				"Json",
+				"Projects"
 			}
 		);
 	}
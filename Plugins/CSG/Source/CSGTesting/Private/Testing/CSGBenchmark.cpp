@@ -0,0 +1,341 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGRebuildSubsystem.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformMemory.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Components/CSGAreaComponent.h"
+#include "Testing/CSGBenchmarkComponent.h"
+#include "Testing/CSGTestWorld.h"
+
+/*
+ * Headless CSG performance benchmark, every scene is a separate test:
+ *
+ *   UnrealEditor-Cmd <Project> -ExecCmds="Automation RunTests CSG.Benchmark; Quit" -nullrhi -unattended
+ *
+ * Results are written to Saved/Automation/CSGBenchmark/<Scene>.json. A scene fails when its timings or its mesh sizes
+ * exceed the baseline in the plugin's Config/CSGBenchmarkBaseline.json by more than the tolerance. No baseline is
+ * shipped, it has to be recorded on the machine running the checks, until then scenes only warn and report results.
+ *
+ * -CSGBenchmarkFrames=<N>           frames to run every scene for, 60 by default
+ * -CSGBenchmarkTolerance=<Fraction> allowed regression over the baseline, 0.2 by default
+ * -CSGBenchmarkBaseline=<Path>      baseline to compare against instead of the one in the plugin
+ * -CSGBenchmarkUpdateBaseline       writes the results into the baseline instead of comparing
+ */
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/// @brief How the areas of a scene move during the benchmark
+	enum class ECSGBenchmarkMotion : uint8
+	{
+		/// @brief Areas are placed on the first frame and stay, measures the initial build and idle frames
+		Static,
+		/// @brief Every area circles around the mesh, every component rebuilds every frame
+		Orbit,
+		/// @brief Areas move onto the mesh one after another and stay there, cuts accumulate
+		Spawn
+	};
+
+	const TCHAR* MotionNames[] = {TEXT("Static"), TEXT("Orbit"), TEXT("Spawn")};
+
+	constexpr float MeshRadius = 100.0f;
+	constexpr float AreaRadius = 30.0f;
+	constexpr float FrameDeltaTime = 1.0f / 60.0f;
+
+	/// @brief Areas waiting to spawn are parked this far away, outside the bounds of the mesh
+	const FVector ParkedLocation(0.0, 0.0, -100000.0);
+
+	struct FCSGBenchmarkScene
+	{
+		int32 TriangleCount = 0;
+		int32 AreaCount = 0;
+		ECSGBenchmarkMotion Motion = ECSGBenchmarkMotion::Static;
+		bool bReverse = false;
+
+		FString GetName() const
+		{
+			return FString::Printf(TEXT("Tris%d_Areas%d_%s_%s"), TriangleCount, AreaCount,
+			                       MotionNames[static_cast<int32>(Motion)], bReverse ? TEXT("Reverse") : TEXT("Forward"));
+		}
+
+		/// @brief Parses the test parameter written by GetTests
+		bool Parse(const FString& Parameters)
+		{
+			TArray<FString> Tokens;
+			Parameters.ParseIntoArray(Tokens, TEXT(" "));
+			if (Tokens.Num() != 4)
+			{
+				return false;
+			}
+
+			TriangleCount = FCString::Atoi(*Tokens[0]);
+			AreaCount = FCString::Atoi(*Tokens[1]);
+			Motion = static_cast<ECSGBenchmarkMotion>(FMath::Clamp(FCString::Atoi(*Tokens[2]), 0, 2));
+			bReverse = Tokens[3] == TEXT("1");
+			return TriangleCount > 0 && AreaCount > 0;
+		}
+
+		/// @brief Location of the area on the frame, on a ring around the mesh so it always cuts the surface
+		FVector GetAreaLocation(int32 Area, int32 Frame, int32 FrameCount) const
+		{
+			double Angle = UE_DOUBLE_TWO_PI * Area / AreaCount;
+			switch (Motion)
+			{
+			case ECSGBenchmarkMotion::Orbit:
+				Angle += Frame * 0.05;
+				break;
+			case ECSGBenchmarkMotion::Spawn:
+				if (Frame < Area * FrameCount / AreaCount)
+				{
+					return ParkedLocation;
+				}
+				break;
+			default:
+				break;
+			}
+
+			const double Height = MeshRadius * 0.5 * FMath::Sin(Angle * 3.0);
+			return FVector(FMath::Cos(Angle) * MeshRadius, FMath::Sin(Angle) * MeshRadius, Height);
+		}
+	};
+
+	struct FCSGBenchmarkResult
+	{
+		int32 Frames = 0;
+		int32 Rebuilds = 0;
+		double TotalMs = 0.0;
+		double MeanFrameMs = 0.0;
+		double MedianFrameMs = 0.0;
+		double MaxFrameMs = 0.0;
+		double MeanEvaluationMs = 0.0;
+		double CollisionMs = 0.0;
+		int32 OutputTriangles = 0;
+		int32 PeakScratchTriangles = 0;
+		int64 MemoryDeltaBytes = 0;
+
+		TSharedRef<FJsonObject> ToJson() const
+		{
+			TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+			Json->SetNumberField(TEXT("Frames"), Frames);
+			Json->SetNumberField(TEXT("Rebuilds"), Rebuilds);
+			Json->SetNumberField(TEXT("TotalMs"), TotalMs);
+			Json->SetNumberField(TEXT("MeanFrameMs"), MeanFrameMs);
+			Json->SetNumberField(TEXT("MedianFrameMs"), MedianFrameMs);
+			Json->SetNumberField(TEXT("MaxFrameMs"), MaxFrameMs);
+			Json->SetNumberField(TEXT("MeanEvaluationMs"), MeanEvaluationMs);
+			Json->SetNumberField(TEXT("CollisionMs"), CollisionMs);
+			Json->SetNumberField(TEXT("OutputTriangles"), OutputTriangles);
+			Json->SetNumberField(TEXT("PeakScratchTriangles"), PeakScratchTriangles);
+			Json->SetNumberField(TEXT("MemoryDeltaBytes"), static_cast<double>(MemoryDeltaBytes));
+			return Json;
+		}
+	};
+
+	/// @brief Metrics compared against the baseline, the rest are only reported since they are too noisy
+	const TCHAR* ComparedMetrics[] = {
+		TEXT("MedianFrameMs"), TEXT("MeanEvaluationMs"), TEXT("OutputTriangles"), TEXT("PeakScratchTriangles")
+	};
+
+	/// @brief Smaller differences are timer noise, scenes that barely rebuild would fail on them otherwise
+	constexpr double MinRegression = 0.1;
+
+	FString GetBaselinePath()
+	{
+		FString Path;
+		if (FParse::Value(FCommandLine::Get(), TEXT("CSGBenchmarkBaseline="), Path))
+		{
+			return Path;
+		}
+
+		const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("CSGArea"));
+		return Plugin ? FPaths::Combine(Plugin->GetBaseDir(), TEXT("Config"), TEXT("CSGBenchmarkBaseline.json")) : FString();
+	}
+
+	TSharedPtr<FJsonObject> LoadJson(const FString& Path)
+	{
+		FString Text;
+		TSharedPtr<FJsonObject> Json;
+		if (FFileHelper::LoadFileToString(Text, *Path))
+		{
+			FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Text), Json);
+		}
+		return Json;
+	}
+
+	bool SaveJson(const TSharedRef<FJsonObject>& Json, const FString& Path)
+	{
+		FString Text;
+		FJsonSerializer::Serialize(Json, TJsonWriterFactory<>::Create(&Text));
+		return FFileHelper::SaveStringToFile(Text, *Path);
+	}
+
+	/// @brief Builds the scene in its own game world and rebuilds it for FrameCount frames
+	FCSGBenchmarkResult RunScene(const FCSGBenchmarkScene& Scene, int32 FrameCount)
+	{
+		const int64 MemoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+
+		FCSGTestWorld TestWorld;
+		UCSGBenchmarkComponent* Component = TestWorld.SpawnMesh(Scene.TriangleCount, MeshRadius, Scene.bReverse);
+
+		TArray<UCSGAreaComponent*> Areas;
+		for (int32 i = 0; i < Scene.AreaCount; ++i)
+		{
+			Areas.Add(TestWorld.SpawnArea(FTransform(ParkedLocation), AreaRadius));
+		}
+
+		UCSGRebuildSubsystem* Scheduler = TestWorld.GetWorld()->GetSubsystem<UCSGRebuildSubsystem>();
+
+		TArray<double> FrameTimes;
+		for (int32 Frame = 0; Frame < FrameCount; ++Frame)
+		{
+			const double Start = FPlatformTime::Seconds();
+
+			for (int32 i = 0; i < Areas.Num(); ++i)
+			{
+				const FVector Location = Scene.GetAreaLocation(i, Frame, FrameCount);
+				if (!Areas[i]->GetComponentLocation().Equals(Location))
+				{
+					Areas[i]->SetWorldLocation(Location);
+				}
+			}
+
+			//the queue is drained every frame, so the time measured isn't capped by the rebuild budget
+			for (int32 Pass = 0; Pass < 100 && Scheduler && Scheduler->GetQueueLength() > 0; ++Pass)
+			{
+				Scheduler->Tick(FrameDeltaTime);
+			}
+
+			FrameTimes.Add((FPlatformTime::Seconds() - Start) * 1000.0);
+		}
+
+		FCSGBenchmarkResult Result;
+		Result.Frames = FrameCount;
+		for (const double FrameTime : FrameTimes)
+		{
+			Result.TotalMs += FrameTime;
+			Result.MaxFrameMs = FMath::Max(Result.MaxFrameMs, FrameTime);
+		}
+		Result.MeanFrameMs = FrameTimes.IsEmpty() ? 0.0 : Result.TotalMs / FrameTimes.Num();
+		FrameTimes.Sort();
+		Result.MedianFrameMs = FrameTimes.IsEmpty() ? 0.0 : FrameTimes[FrameTimes.Num() / 2];
+
+		const FCSGRebuildStats Stats = Component->GetRebuildStats();
+		Result.Rebuilds = Stats.RebuildCount;
+		Result.MeanEvaluationMs = Stats.RebuildCount > 0 ? Stats.TotalEvaluationMs / Stats.RebuildCount : 0.0;
+		Result.CollisionMs = Stats.LastCollisionMs;
+		Result.OutputTriangles = Stats.OutputTriangleCount;
+		Result.PeakScratchTriangles = Component->GetScratchMeshStats().PeakTriangleCount;
+		Result.MemoryDeltaBytes = static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - MemoryBefore;
+
+		return Result;
+	}
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FCSGBenchmarkTest, "CSG.Benchmark",
+                                  EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                  EAutomationTestFlags::PerfFilter)
+
+void FCSGBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const int32 TriangleCount : {2000, 20000, 100000})
+	{
+		for (const int32 AreaCount : {1, 8, 32})
+		{
+			for (int32 Motion = 0; Motion < static_cast<int32>(UE_ARRAY_COUNT(MotionNames)); ++Motion)
+			{
+				for (const bool bReverse : {false, true})
+				{
+					FCSGBenchmarkScene Scene{TriangleCount, AreaCount, static_cast<ECSGBenchmarkMotion>(Motion), bReverse};
+					OutBeautifiedNames.Add(Scene.GetName());
+					OutTestCommands.Add(FString::Printf(TEXT("%d %d %d %d"), TriangleCount, AreaCount, Motion,
+					                                    bReverse ? 1 : 0));
+				}
+			}
+		}
+	}
+}
+
+bool FCSGBenchmarkTest::RunTest(const FString& Parameters)
+{
+	FCSGBenchmarkScene Scene;
+	if (!Scene.Parse(Parameters))
+	{
+		AddError(FString::Printf(TEXT("Invalid benchmark parameters: %s"), *Parameters));
+		return false;
+	}
+
+	int32 FrameCount = 60;
+	FParse::Value(FCommandLine::Get(), TEXT("CSGBenchmarkFrames="), FrameCount);
+	float Tolerance = 0.2f;
+	FParse::Value(FCommandLine::Get(), TEXT("CSGBenchmarkTolerance="), Tolerance);
+
+	const FString Name = Scene.GetName();
+	const FCSGBenchmarkResult Result = RunScene(Scene, FMath::Max(FrameCount, 1));
+	const TSharedRef<FJsonObject> Json = Result.ToJson();
+
+	const FString ResultPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Automation"), TEXT("CSGBenchmark"),
+	                                           Name + TEXT(".json"));
+	if (!SaveJson(Json, ResultPath))
+	{
+		AddWarning(FString::Printf(TEXT("Couldn't write %s"), *ResultPath));
+	}
+	AddInfo(FString::Printf(TEXT("%s: %.3f ms median frame, %.3f ms per evaluation, %d rebuilds"), *Name,
+	                        Result.MedianFrameMs, Result.MeanEvaluationMs, Result.Rebuilds));
+
+	const FString BaselinePath = GetBaselinePath();
+	TSharedPtr<FJsonObject> Baseline = LoadJson(BaselinePath);
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("CSGBenchmarkUpdateBaseline")))
+	{
+		if (!Baseline)
+		{
+			Baseline = MakeShared<FJsonObject>();
+		}
+		Baseline->SetObjectField(Name, Json);
+		if (!SaveJson(Baseline.ToSharedRef(), BaselinePath))
+		{
+			AddError(FString::Printf(TEXT("Couldn't write the baseline %s"), *BaselinePath));
+		}
+		return true;
+	}
+
+	//baselines are only meaningful on the machine they were recorded on, so none is shipped with the plugin,
+	//a scene without one only reports its results
+	const TSharedPtr<FJsonObject>* Expected = nullptr;
+	if (!Baseline || !Baseline->TryGetObjectField(Name, Expected))
+	{
+		AddWarning(FString::Printf(TEXT("No baseline for %s in %s, results are in %s. ")
+		                           TEXT("Run with -CSGBenchmarkUpdateBaseline on the machine running the checks to record one"),
+		                           *Name, *BaselinePath, *ResultPath));
+		return true;
+	}
+
+	for (const TCHAR* Metric : ComparedMetrics)
+	{
+		double ExpectedValue = 0.0;
+		if (!(*Expected)->TryGetNumberField(Metric, ExpectedValue))
+		{
+			continue;
+		}
+
+		const double Value = Json->GetNumberField(Metric);
+		if (Value > ExpectedValue * (1.0 + Tolerance) && Value - ExpectedValue > MinRegression)
+		{
+			AddError(FString::Printf(TEXT("%s regressed: %.3f, baseline %.3f, tolerance %.0f%%"), Metric, Value,
+			                         ExpectedValue, Tolerance * 100.0f));
+		}
+	}
+
+	return !HasAnyErrors();
+}
+
+#endif
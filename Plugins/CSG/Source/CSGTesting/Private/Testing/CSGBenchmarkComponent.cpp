@@ -0,0 +1,58 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Testing/CSGBenchmarkComponent.h"
+
+#include "UDynamicMesh.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "Generators/SphereGenerator.h"
+
+void UCSGBenchmarkComponent::SetupBenchmark(int32 TriangleCount, float Radius, bool bReverse)
+{
+	//a lat long sphere has two triangles per step along both axes
+	const int32 Steps = FMath::Max(FMath::RoundToInt(FMath::Sqrt(TriangleCount / 2.0f)), 3);
+
+	UE::Geometry::FSphereGenerator Generator;
+	Generator.Radius = Radius;
+	Generator.NumPhi = Steps;
+	Generator.NumTheta = Steps;
+	Generator.Generate();
+
+	UE::Geometry::FDynamicMesh3 Mesh(&Generator);
+	if (!Mesh.HasAttributes())
+	{
+		Mesh.EnableAttributes();
+	}
+	Mesh.Attributes()->EnableMaterialID();
+
+	SourceMesh = MakeShared<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>(MoveTemp(Mesh));
+	bDoReverseCSG = bReverse;
+	MarkCSGDirty();
+}
+
+FBox UCSGBenchmarkComponent::GetLocalSourceBounds() const
+{
+	if (!SourceMesh)
+	{
+		return Super::GetLocalSourceBounds();
+	}
+	return FBox(SourceMesh->GetBounds());
+}
+
+void UCSGBenchmarkComponent::GetVisualMesh_Implementation(UDynamicMesh* OutMesh)
+{
+	++SourceFetchCount;
+	if (SourceMesh)
+	{
+		OutMesh->SetMesh(*SourceMesh);
+	}
+}
+
+void UCSGBenchmarkComponent::GetCollisionMesh_Implementation(UDynamicMesh* OutMesh)
+{
+	++SourceFetchCount;
+	if (SourceMesh)
+	{
+		OutMesh->SetMesh(*SourceMesh);
+	}
+}
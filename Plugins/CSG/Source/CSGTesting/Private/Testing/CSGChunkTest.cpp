@@ -0,0 +1,83 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGMeshOperations.h"
+#include "MeshQueries.h"
+#include "Misc/AutomationTest.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "Generators/SphereGenerator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCSGChunkTest, "CSG.Chunks.Seams",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ProductFilter)
+
+bool FCSGChunkTest::RunTest(const FString& Parameters)
+{
+	using namespace UE::Geometry;
+
+	FSphereGenerator Generator;
+	Generator.Radius = 100.0f;
+	Generator.NumPhi = 32;
+	Generator.NumTheta = 32;
+	Generator.Generate();
+
+	FDynamicMesh3 Mesh(&Generator);
+	if (!Mesh.HasAttributes())
+	{
+		Mesh.EnableAttributes();
+	}
+	Mesh.Attributes()->EnableMaterialID();
+
+	//the area sits on the first two seams, so it cuts several chunks
+	FCSGAreaSnapshot Area;
+	Area.Transform = FTransform(FVector(100.0, 0.0, 0.0));
+	Area.Radius = 30.0f;
+	Area.MaterialID = 1;
+
+	auto Evaluate = [&Mesh, &Area](int32 MaxChunkTriangles)
+	{
+		FCSGRebuildInput Input;
+		Input.VisualMesh = Mesh;
+		Input.Areas.Add(Area);
+		Input.CSGMaterialID = 1;
+		Input.bReverse = true;
+		Input.bEvaluateCollision = false;
+		Input.MaxChunkTriangles = MaxChunkTriangles;
+		if (MaxChunkTriangles > 0)
+		{
+			Input.VisualChunks = MakeShared<FCSGChunkCache, ESPMode::ThreadSafe>();
+		}
+
+		FCSGRebuildResult Result;
+		CSG::Evaluate(Input, Result);
+		return MoveTemp(Result.VisualMesh);
+	};
+
+	const FDynamicMesh3 Whole = Evaluate(0);
+	const FDynamicMesh3 Chunked = Evaluate(300);
+
+	TestTrue(TEXT("The chunked result is closed"), Chunked.IsClosed());
+
+	int32 SeamTriangles = 0;
+	for (const int32 Triangle : Chunked.TriangleIndicesItr())
+	{
+		SeamTriangles += Chunked.Attributes()->GetMaterialID()->GetValue(Triangle) < 0;
+	}
+	TestEqual(TEXT("No faces closing the chunks are left"), SeamTriangles, 0);
+
+	//faces left inside the mesh would add to the area without changing the volume
+	const FVector2d WholeVolumeArea = TMeshQueries<FDynamicMesh3>::GetVolumeArea(Whole);
+	const FVector2d ChunkedVolumeArea = TMeshQueries<FDynamicMesh3>::GetVolumeArea(Chunked);
+	TestTrue(TEXT("The chunked result has the volume of the whole one"),
+	         FMath::IsNearlyEqual(ChunkedVolumeArea.X, WholeVolumeArea.X, WholeVolumeArea.X * 0.01));
+	TestTrue(TEXT("The chunked result has no internal faces"),
+	         FMath::IsNearlyEqual(ChunkedVolumeArea.Y, WholeVolumeArea.Y, WholeVolumeArea.Y * 0.01));
+
+	TestTrue(TEXT("The seams add only a few triangles"), Chunked.TriangleCount() < Whole.TriangleCount() * 3 / 2);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,48 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGRebuildSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "Components/CSGAreaComponent.h"
+#include "Testing/CSGBenchmarkComponent.h"
+#include "Testing/CSGTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCSGDeferredRebuildTest, "CSG.Rebuild.DeferredCollision",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ProductFilter)
+
+bool FCSGDeferredRebuildTest::RunTest(const FString& Parameters)
+{
+	FCSGTestWorld TestWorld;
+	UCSGBenchmarkComponent* Component = TestWorld.SpawnMesh(2000, 100.0f, true);
+	UCSGAreaComponent* Area = TestWorld.SpawnArea(FTransform(FVector(100.0, 0.0, 0.0)), 30.0f);
+	UCSGRebuildSubsystem* Scheduler = TestWorld.GetWorld()->GetSubsystem<UCSGRebuildSubsystem>();
+
+	Scheduler->Tick(0.0f);
+	TestEqual(TEXT("The first rebuild builds the collision right away"), Component->GetRebuildStats().RebuildCount, 1);
+
+	//the world time doesn't advance, so the collision stays stale for the rest of the test
+	Component->SetCollisionUpdateInterval(1000.0f);
+	Area->SetWorldLocation(FVector(0.0, 100.0, 0.0));
+	Scheduler->Tick(0.0f);
+	TestEqual(TEXT("The visual mesh is rebuilt without the collision"), Component->GetRebuildStats().RebuildCount, 2);
+
+	for (int32 Frame = 0; Frame < 3; ++Frame)
+	{
+		Scheduler->Tick(0.0f);
+		TestEqual(TEXT("The component waiting on its collision isn't queued"), Scheduler->GetQueueLength(), 0);
+		TestEqual(TEXT("The component waiting on its collision stays parked"), Scheduler->GetWaitingCount(), 1);
+	}
+	TestEqual(TEXT("Nothing gets rebuilt while waiting"), Component->GetRebuildStats().RebuildCount, 2);
+
+	//moving the area again queues the component right away
+	Area->SetWorldLocation(FVector(0.0, -100.0, 0.0));
+	TestEqual(TEXT("A request moves the parked component into the queue"), Scheduler->GetQueueLength(), 1);
+	TestEqual(TEXT("A queued component isn't parked at the same time"), Scheduler->GetWaitingCount(), 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,67 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGRebuildSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "Testing/CSGBenchmarkComponent.h"
+#include "Testing/CSGTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCSGRebuildBudgetTest, "CSG.Rebuild.Budget",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ProductFilter)
+
+bool FCSGRebuildBudgetTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 ComponentCount = 24;
+	constexpr float BudgetMs = 1.0f;
+
+	FCSGTestWorld TestWorld;
+	TArray<UCSGBenchmarkComponent*> Components;
+	for (int32 i = 0; i < ComponentCount; ++i)
+	{
+		Components.Add(TestWorld.SpawnMesh(20000, 100.0f, true));
+	}
+	TestWorld.SpawnArea(FTransform(FVector(100.0, 0.0, 0.0)), 30.0f);
+
+	UCSGRebuildSubsystem* Scheduler = TestWorld.GetWorld()->GetSubsystem<UCSGRebuildSubsystem>();
+	Scheduler->SetRebuildBudgetOverride(BudgetMs);
+
+	auto CountRebuilds = [&Components]()
+	{
+		int32 Count = 0;
+		for (const UCSGBenchmarkComponent* Component : Components)
+		{
+			Count += Component->GetRebuildStats().RebuildCount;
+		}
+		return Count;
+	};
+
+	int32 Frames = 0;
+	for (; Frames < ComponentCount * 2 && Scheduler->GetQueueLength() > 0; ++Frames)
+	{
+		const int32 RebuildsBefore = CountRebuilds();
+		const double Start = FPlatformTime::Seconds();
+		Scheduler->Tick(0.0f);
+		const double FrameMs = (FPlatformTime::Seconds() - Start) * 1000.0;
+
+		float SlowestMs = 0.0f;
+		for (const UCSGBenchmarkComponent* Component : Components)
+		{
+			SlowestMs = FMath::Max(SlowestMs, Component->GetRebuildStats().LastEvaluationMs);
+		}
+
+		//only the one component every frame has to rebuild may run over the budget
+		TestTrue(FString::Printf(TEXT("Frame %d took %.2f ms for %d rebuilds, the budget is %.2f ms and the slowest evaluation %.2f ms"),
+		                         Frames, FrameMs, CountRebuilds() - RebuildsBefore, BudgetMs, SlowestMs),
+		         FrameMs <= BudgetMs + SlowestMs * 1.5f);
+	}
+
+	TestTrue(TEXT("The components are spread over several frames"), Frames > 1);
+	TestEqual(TEXT("Every component got rebuilt"), CountRebuilds(), ComponentCount);
+
+	return true;
+}
+
+#endif
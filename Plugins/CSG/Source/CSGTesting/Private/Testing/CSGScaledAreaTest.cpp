@@ -0,0 +1,33 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "Components/CSGAreaComponent.h"
+#include "Testing/CSGBenchmarkComponent.h"
+#include "Testing/CSGTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCSGScaledAreaTest, "CSG.Areas.NonUniformScale",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ProductFilter)
+
+bool FCSGScaledAreaTest::RunTest(const FString& Parameters)
+{
+	FCSGTestWorld TestWorld;
+	UCSGBenchmarkComponent* Component = TestWorld.SpawnMesh(2000, 100.0f, true);
+
+	//stretched along Z the area reaches from 50 to 450 above the origin, its smallest axis only spans 240 to 260
+	const FTransform Transform(FQuat::Identity, FVector(0.0, 0.0, 250.0), FVector(1.0, 1.0, 20.0));
+	const UCSGAreaComponent* Area = TestWorld.SpawnArea(Transform, 10.0f);
+
+	TestEqual(TEXT("The area radius uses the largest axis scale"), Area->GetCutterWorldRadius(), 200.0f);
+
+	TArray<const UCSGAreaComponent*> Areas;
+	Component->GatherAreasForTesting(Areas);
+	TestTrue(TEXT("The stretched area is found for the mesh it cuts"), Areas.Contains(Area));
+
+	return true;
+}
+
+#endif
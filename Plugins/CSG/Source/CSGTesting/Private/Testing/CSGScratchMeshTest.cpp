@@ -0,0 +1,52 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "UDynamicMesh.h"
+#include "Misc/AutomationTest.h"
+#include "Components/CSGAreaComponent.h"
+#include "Testing/CSGBenchmarkComponent.h"
+#include "Testing/CSGTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCSGScratchMeshTest, "CSG.Rebuild.ScratchMeshes",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ProductFilter)
+
+bool FCSGScratchMeshTest::RunTest(const FString& Parameters)
+{
+	FCSGTestWorld TestWorld;
+	UCSGBenchmarkComponent* Component = TestWorld.SpawnMesh(2000, 100.0f, true);
+	UCSGAreaComponent* Area = TestWorld.SpawnArea(FTransform(FVector(100.0, 0.0, 0.0)), 30.0f);
+
+	Component->ProcessRebuild();
+
+	UDynamicMesh* Source = Component->GetScratchMeshForTesting(ECSGScratchMesh::VisualSource);
+	UDynamicMesh* Collision = Component->GetScratchMeshForTesting(ECSGScratchMesh::CollisionResult);
+	const UE::Geometry::FDynamicMesh3* SourceData = Source->GetMeshPtr();
+	const UE::Geometry::FDynamicMesh3* CollisionData = Collision->GetMeshPtr();
+	const int32 SourceTriangles = Source->GetTriangleCount();
+	TestTrue(TEXT("The source stays in its scratch mesh after a rebuild"), SourceTriangles > 0);
+
+	//moving the area changes the fingerprint without marking the component dirty
+	Area->SetWorldLocation(FVector(0.0, 100.0, 0.0));
+	Component->ProcessRebuild();
+
+	TestEqual(TEXT("Both rebuilds were applied"), Component->GetRebuildStats().RebuildCount, 2);
+	TestEqual(TEXT("The source is only fetched once per mesh"), Component->GetSourceFetchCount(), 2);
+	TestEqual(TEXT("No scratch mesh gets added by the second rebuild"), Component->GetScratchMeshStats().MeshCount, 3);
+
+	TestTrue(TEXT("The source scratch mesh is reused"),
+	         Component->GetScratchMeshForTesting(ECSGScratchMesh::VisualSource) == Source &&
+	         Source->GetMeshPtr() == SourceData);
+	TestEqual(TEXT("The source scratch mesh keeps its triangles"), Source->GetTriangleCount(), SourceTriangles);
+
+	TestTrue(TEXT("The collision result is copied into the same scratch mesh"),
+	         Component->GetScratchMeshForTesting(ECSGScratchMesh::CollisionResult) == Collision &&
+	         Collision->GetMeshPtr() == CollisionData);
+	TestTrue(TEXT("The collision result holds the second rebuild"), Collision->GetTriangleCount() > 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,72 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGMeshOperations.h"
+#include "Misc/AutomationTest.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "Generators/SphereGenerator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCSGSdfMaterialTest, "CSG.Sdf.AreaMaterials",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ProductFilter)
+
+bool FCSGSdfMaterialTest::RunTest(const FString& Parameters)
+{
+	using namespace UE::Geometry;
+
+	FSphereGenerator Generator;
+	Generator.Radius = 100.0f;
+	Generator.NumPhi = 32;
+	Generator.NumTheta = 32;
+	Generator.Generate();
+
+	FCSGRebuildInput Input;
+	Input.VisualMesh = FDynamicMesh3(&Generator);
+	if (!Input.VisualMesh.HasAttributes())
+	{
+		Input.VisualMesh.EnableAttributes();
+	}
+	Input.VisualMesh.Attributes()->EnableMaterialID();
+	Input.CSGMaterialID = 1;
+	Input.bReverse = true;
+	Input.bEvaluateCollision = false;
+	Input.VisualSdf = CSG::MakeSdfCache(5.0f);
+
+	//one area on each side of the sphere, each with its own cut material
+	for (const int32 Side : {1, -1})
+	{
+		FCSGAreaSnapshot& Area = Input.Areas.AddDefaulted_GetRef();
+		Area.Transform = FTransform(FVector(100.0 * Side, 0.0, 0.0));
+		Area.Radius = 30.0f;
+		Area.MaterialID = Side > 0 ? 1 : 2;
+	}
+
+	FCSGRebuildResult Result;
+	CSG::Evaluate(Input, Result);
+	const FDynamicMesh3& Mesh = Result.VisualMesh;
+
+	int32 CutTriangles[2] = {0, 0};
+	int32 WrongSide = 0;
+	for (const int32 Triangle : Mesh.TriangleIndicesItr())
+	{
+		const int32 MaterialID = Mesh.Attributes()->GetMaterialID()->GetValue(Triangle);
+		if (MaterialID == 0)
+		{
+			continue;
+		}
+
+		const double X = Mesh.GetTriCentroid(Triangle).X;
+		WrongSide += MaterialID == 1 ? X < 0.0 : X > 0.0;
+		++CutTriangles[MaterialID == 1 ? 0 : 1];
+	}
+
+	TestTrue(TEXT("The first area creates faces with its material"), CutTriangles[0] > 0);
+	TestTrue(TEXT("The second area creates faces with its material"), CutTriangles[1] > 0);
+	TestEqual(TEXT("Every cut face has the material of the area that created it"), WrongSide, 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,68 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGMeshOperations.h"
+#include "Misc/AutomationTest.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "Generators/SphereGenerator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCSGSphereCutTest, "CSG.AnalyticCut.Sphere",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ProductFilter)
+
+bool FCSGSphereCutTest::RunTest(const FString& Parameters)
+{
+	using namespace UE::Geometry;
+
+	//the same 2000 triangle sphere the benchmark cuts
+	FSphereGenerator Generator;
+	Generator.Radius = 100.0f;
+	Generator.NumPhi = 32;
+	Generator.NumTheta = 32;
+	Generator.Generate();
+
+	FDynamicMesh3 Mesh(&Generator);
+	if (!Mesh.HasAttributes())
+	{
+		Mesh.EnableAttributes();
+	}
+	Mesh.Attributes()->EnableMaterialID();
+
+	constexpr int32 CapMaterialID = 1;
+
+	for (const FVector& Location : {FVector(100.0, 0.0, 0.0), FVector(60.0, 50.0, 20.0), FVector(0.0, 0.0, 90.0)})
+	{
+		FCSGAreaSnapshot Area;
+		Area.Transform = FTransform(Location);
+		Area.Radius = 30.0f;
+
+		for (const CSG::EBooleanOp Operation : {CSG::EBooleanOp::Subtract, CSG::EBooleanOp::Intersection})
+		{
+			const FString Case = FString::Printf(TEXT("%s at %s"),
+			                                     Operation == CSG::EBooleanOp::Subtract ? TEXT("Subtract") : TEXT("Intersect"),
+			                                     *Location.ToString());
+
+			FDynamicMesh3 Result;
+			if (!TestTrue(FString::Printf(TEXT("%s takes the analytic path"), *Case),
+			              CSG::TrySphereCut(Mesh, FTransform::Identity, Area, Operation, CapMaterialID, Result)))
+			{
+				continue;
+			}
+
+			TestTrue(FString::Printf(TEXT("%s is closed"), *Case), Result.IsClosed());
+
+			int32 CapTriangles = 0;
+			for (const int32 Triangle : Result.TriangleIndicesItr())
+			{
+				CapTriangles += Result.Attributes()->GetMaterialID()->GetValue(Triangle) == CapMaterialID;
+			}
+			TestTrue(FString::Printf(TEXT("%s is capped"), *Case), CapTriangles > 0);
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,51 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Testing/CSGTestWorld.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Components/CSGAreaComponent.h"
+#include "Testing/CSGBenchmarkComponent.h"
+
+FCSGTestWorld::FCSGTestWorld()
+{
+	World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("CSGTest"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+}
+
+FCSGTestWorld::~FCSGTestWorld()
+{
+	World->BeginTearingDown();
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		It->RouteEndPlay(EEndPlayReason::Destroyed);
+	}
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+}
+
+UCSGBenchmarkComponent* FCSGTestWorld::SpawnMesh(int32 TriangleCount, float Radius, bool bReverse)
+{
+	AActor* Actor = World->SpawnActor<AActor>();
+	UCSGBenchmarkComponent* Component = NewObject<UCSGBenchmarkComponent>(Actor);
+	Component->SetupBenchmark(TriangleCount, Radius, bReverse);
+	Actor->SetRootComponent(Component);
+	Component->RegisterComponent();
+	return Component;
+}
+
+UCSGAreaComponent* FCSGTestWorld::SpawnArea(const FTransform& Transform, float Radius)
+{
+	AActor* Actor = World->SpawnActor<AActor>();
+	UCSGAreaComponent* Area = NewObject<UCSGAreaComponent>(Actor);
+	Area->SetSphereRadius(Radius, false);
+	Area->SetWorldTransform(Transform);
+	Actor->SetRootComponent(Area);
+	Area->RegisterComponent();
+	return Area;
+}
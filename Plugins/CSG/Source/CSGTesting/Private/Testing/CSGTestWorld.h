@@ -0,0 +1,33 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCSGAreaComponent;
+class UCSGBenchmarkComponent;
+
+/// @brief Game world the CSG automation tests build their scenes in, it's torn down when this goes out of scope
+class FCSGTestWorld
+{
+public:
+	FCSGTestWorld();
+	~FCSGTestWorld();
+
+	FCSGTestWorld(const FCSGTestWorld&) = delete;
+	FCSGTestWorld& operator=(const FCSGTestWorld&) = delete;
+
+	UWorld* GetWorld() const
+	{
+		return World;
+	}
+
+	/// @brief Spawns an actor with a CSG component cutting a generated sphere around the origin
+	UCSGBenchmarkComponent* SpawnMesh(int32 TriangleCount, float Radius, bool bReverse);
+
+	/// @brief Spawns an actor with a sphere area
+	UCSGAreaComponent* SpawnArea(const FTransform& Transform, float Radius);
+
+private:
+	UWorld* World = nullptr;
+};
@@ -0,0 +1,55 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/CSGBaseComponent.h"
+#include "CSGBenchmarkComponent.generated.h"
+
+/// @brief CSG component cutting a generated sphere of a fixed triangle count, used by the CSG automation tests
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class CSGTESTING_API UCSGBenchmarkComponent : public UCSGBaseComponent
+{
+	GENERATED_BODY()
+
+public:
+	/// Sets up the source mesh and the CSG mode, has to be called before the component begins play
+	///
+	/// @param TriangleCount Approximate amount of triangles of the source sphere
+	/// @param bReverse Whether the areas get subtracted instead of intersected
+	void SetupBenchmark(int32 TriangleCount, float Radius, bool bReverse);
+
+	virtual FBox GetLocalSourceBounds() const override;
+
+	/// @brief Times GetVisualMesh and GetCollisionMesh have been called
+	int32 GetSourceFetchCount() const
+	{
+		return SourceFetchCount;
+	}
+
+	UDynamicMesh* GetScratchMeshForTesting(ECSGScratchMesh Role)
+	{
+		return GetScratchMesh(Role);
+	}
+
+	void GatherAreasForTesting(TArray<const UCSGAreaComponent*>& OutAreas) const
+	{
+		GatherAreas(OutAreas);
+	}
+
+	/// @brief Rebuilds the collision at most once every Interval seconds
+	void SetCollisionUpdateInterval(float Interval)
+	{
+		CollisionUpdatePolicy = ECSGCollisionUpdatePolicy::RateLimited;
+		CollisionUpdateInterval = Interval;
+	}
+
+protected:
+	virtual void GetVisualMesh_Implementation(UDynamicMesh* OutMesh) override;
+	virtual void GetCollisionMesh_Implementation(UDynamicMesh* OutMesh) override;
+
+	/// @brief Generated once, every rebuild copies it like a converted static mesh would be
+	TSharedPtr<const UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> SourceMesh;
+
+	int32 SourceFetchCount = 0;
+};